@@ -0,0 +1,180 @@
+/**
+ * CheckedCount is a non-negative integer for counting trees. Values are kept
+ * in 128-bit integers with overflow-checked arithmetic, and are promoted to an
+ * arbitrary precision boost cpp_int only when they don't fit, so counting
+ * doesn't allocate unless the counts are actually huge. Values that fit in 128
+ * bits are always stored unpromoted.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+#include <boost/multiprecision/cpp_int.hpp>
+
+#include "larch/common.hpp"
+
+class CheckedCount {
+ public:
+  using Big = boost::multiprecision::cpp_int;
+
+  CheckedCount() = default;
+
+  template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+  CheckedCount(T value)  // NOLINT(google-explicit-constructor)
+      : small_{static_cast<Small>(value)} {
+    if constexpr (std::is_signed_v<T>) {
+      Assert(value >= 0);
+    }
+  }
+
+  explicit CheckedCount(const Big& value) {
+    Assert(value >= 0);
+    if (value >> 128 == 0) {
+      small_ = (static_cast<Small>(static_cast<std::uint64_t>(value >> 64)) << 64) |
+               static_cast<std::uint64_t>(value & ~std::uint64_t{0});
+    } else {
+      big_ = std::make_shared<const Big>(value);
+    }
+  }
+
+  /**
+   * Whether the value is held in a fixed-width integer.
+   */
+  bool IsSmall() const { return big_ == nullptr; }
+
+  Big ToCppInt() const {
+    if (not IsSmall()) {
+      return *big_;
+    }
+    return (Big{static_cast<std::uint64_t>(small_ >> 64)} << 64) |
+           static_cast<std::uint64_t>(small_);
+  }
+
+  explicit operator double() const {
+    return IsSmall() ? static_cast<double>(small_) : big_->convert_to<double>();
+  }
+
+  /**
+   * The quotient this / total as a double, without overflowing when the
+   * counts are too large for a double.
+   */
+  double Fraction(const CheckedCount& total) const {
+    Assert(total != 0);
+    if (IsSmall() and total.IsSmall()) {
+      return static_cast<double>(small_) / static_cast<double>(total.small_);
+    }
+    // drop the same number of low bits from both, so that the total fits
+    constexpr unsigned MaxBits = 1000;
+    const Big total_value = total.ToCppInt();
+    const unsigned total_bits = boost::multiprecision::msb(total_value) + 1;
+    const unsigned shift = total_bits > MaxBits ? total_bits - MaxBits : 0;
+    return (ToCppInt() >> shift).convert_to<double>() /
+           (total_value >> shift).convert_to<double>();
+  }
+
+  std::string ToString() const {
+    if (not IsSmall()) {
+      return big_->str();
+    }
+    std::string result;
+    Small value = small_;
+    do {
+      result.push_back(static_cast<char>('0' + static_cast<int>(value % 10)));
+      value /= 10;
+    } while (value != 0);
+    return {result.rbegin(), result.rend()};
+  }
+
+  CheckedCount& operator+=(const CheckedCount& rhs) {
+    Small sum{};
+    if (IsSmall() and rhs.IsSmall() and
+        not __builtin_add_overflow(small_, rhs.small_, &sum)) {
+      small_ = sum;
+      return *this;
+    }
+    return *this = CheckedCount{ToCppInt() + rhs.ToCppInt()};
+  }
+
+  CheckedCount& operator*=(const CheckedCount& rhs) {
+    Small product{};
+    if (IsSmall() and rhs.IsSmall() and
+        not __builtin_mul_overflow(small_, rhs.small_, &product)) {
+      small_ = product;
+      return *this;
+    }
+    return *this = CheckedCount{ToCppInt() * rhs.ToCppInt()};
+  }
+
+  /**
+   * Integer division.
+   */
+  CheckedCount& operator/=(const CheckedCount& rhs) {
+    if (IsSmall() and rhs.IsSmall()) {
+      Assert(rhs.small_ != 0);
+      small_ /= rhs.small_;
+      return *this;
+    }
+    return *this = CheckedCount{ToCppInt() / rhs.ToCppInt()};
+  }
+
+  CheckedCount& operator++() { return *this += 1; }
+
+  CheckedCount operator++(int) {
+    CheckedCount result = *this;
+    *this += 1;
+    return result;
+  }
+
+  friend CheckedCount operator+(CheckedCount lhs, const CheckedCount& rhs) {
+    return lhs += rhs;
+  }
+  friend CheckedCount operator*(CheckedCount lhs, const CheckedCount& rhs) {
+    return lhs *= rhs;
+  }
+  friend CheckedCount operator/(CheckedCount lhs, const CheckedCount& rhs) {
+    return lhs /= rhs;
+  }
+
+  friend bool operator==(const CheckedCount& lhs, const CheckedCount& rhs) {
+    if (lhs.IsSmall() != rhs.IsSmall()) {
+      return false;
+    }
+    return lhs.IsSmall() ? lhs.small_ == rhs.small_ : *lhs.big_ == *rhs.big_;
+  }
+  friend bool operator!=(const CheckedCount& lhs, const CheckedCount& rhs) {
+    return not(lhs == rhs);
+  }
+  friend bool operator<(const CheckedCount& lhs, const CheckedCount& rhs) {
+    // promoted values are larger than all unpromoted ones
+    if (lhs.IsSmall() != rhs.IsSmall()) {
+      return lhs.IsSmall();
+    }
+    return lhs.IsSmall() ? lhs.small_ < rhs.small_ : *lhs.big_ < *rhs.big_;
+  }
+  friend bool operator>(const CheckedCount& lhs, const CheckedCount& rhs) {
+    return rhs < lhs;
+  }
+  friend bool operator<=(const CheckedCount& lhs, const CheckedCount& rhs) {
+    return not(rhs < lhs);
+  }
+  friend bool operator>=(const CheckedCount& lhs, const CheckedCount& rhs) {
+    return not(lhs < rhs);
+  }
+
+  friend std::ostream& operator<<(std::ostream& os, const CheckedCount& count) {
+    return os << count.ToString();
+  }
+
+ private:
+  __extension__ typedef unsigned __int128 Small;
+
+  Small small_ = 0;
+  // set only for values that don't fit in small_, shared between copies as
+  // it's never modified
+  std::shared_ptr<const Big> big_;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <limits>
 #include <vector>
 #include <set>
@@ -274,6 +275,16 @@ inline constexpr const auto HashCombine = [](size_t lhs, size_t rhs) noexcept {
   return lhs;
 };
 
+/**
+ * The splitmix64 finalizer, a bijective mix of the bits of `x`, so that sums
+ * of mixed values of different inputs don't collide easily.
+ */
+inline constexpr std::uint64_t SplitMix64(std::uint64_t x) noexcept {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+  return x ^ (x >> 31);
+}
+
 #define STRINGIFY(x) #x
 #define TOSTRING(x) STRINGIFY(x)
 
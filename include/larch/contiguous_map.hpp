@@ -4,6 +4,8 @@
 #include <algorithm>
 #include <initializer_list>
 
+#include "larch/memory_usage.hpp"
+
 template <typename K, typename V>
 class ContiguousMap {
  public:
@@ -46,6 +48,8 @@ class ContiguousMap {
 
   size_t size() const { return data_.size(); }
 
+  size_t HeapMemoryUsage() const { return ::HeapMemoryUsage(data_); }
+
   iterator begin() { return data_.begin(); }
 
   iterator end() { return data_.end(); }
@@ -125,6 +129,14 @@ class ContiguousMap {
 
   bool Contains(const K& key) const { return find(key) != data_.end(); }
 
+  /**
+   * Append an element with a key greater than all keys in the map.
+   */
+  void push_back(value_type&& value) {
+    Assert(empty() or data_.back().first < value.first);
+    data_.push_back(std::move(value));
+  }
+
   void Union(const ContiguousMap& other) {
     storage_type result;
     result.reserve(std::max(data_.size(), other.data_.size()));
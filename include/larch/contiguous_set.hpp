@@ -3,6 +3,8 @@
 #include <vector>
 #include <algorithm>
 
+#include "larch/memory_usage.hpp"
+
 template <typename T, typename Compare = std::less<T>,
           typename Allocator = std::allocator<T>>
 class ContiguousSet {
@@ -57,6 +59,8 @@ class ContiguousSet {
 
   size_t size() const { return data_.size(); }
 
+  size_t HeapMemoryUsage() const { return ::HeapMemoryUsage(data_); }
+
   iterator begin() { return data_.begin(); }
 
   iterator end() { return data_.end(); }
@@ -10,6 +10,7 @@
 struct Connections {
   MOVE_ONLY_DEF_CTOR(Connections);
   explicit Connections(NodeId root_node_id) : root_{root_node_id} {}
+  size_t HeapMemoryUsage() const { return ::HeapMemoryUsage(leafs_); }
   NodeId root_;
   std::vector<NodeId> leafs_;
 };
@@ -5,6 +5,7 @@
 #include <type_traits>
 
 #include "larch/common.hpp"
+#include "larch/memory_usage.hpp"
 
 #define DAG_DECLARATIONS
 #include "larch/dag/dag_common.hpp"
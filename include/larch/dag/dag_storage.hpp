@@ -35,6 +35,14 @@ struct ExtraStorage {
     return storage;
   }
 
+  MemoryUsageReport MemoryUsage() const {
+    FeaturesMemoryUsage<FeatureTypes> features;
+    features.Accumulate(features_storage_);
+    MemoryUsageReport result;
+    features.AddTo(result);
+    return result;
+  }
+
  private:
   FeatureTypes features_storage_;
 };
@@ -182,6 +190,12 @@ struct DAGStorage {
   auto& GetTargetStorage() { return features_storage_.GetTargetStorage(*this); }
   auto& GetTargetStorage() const { return features_storage_.GetTargetStorage(*this); }
 
+  /**
+   * Bytes used by the nodes and edges containers and the per-DAG features,
+   * broken down by feature.
+   */
+  MemoryUsageReport MemoryUsage() const;
+
   NodesContainerT& GetNodesContainer() { return nodes_container_; }
   EdgesContainerT& GetEdgesContainer() { return edges_container_; }
 
@@ -20,6 +20,8 @@ struct ExtraFeatureStorage<Deduplicate<Feature>> {
   ExtraFeatureStorage() = default;
   MOVE_ONLY(ExtraFeatureStorage);
 
+  size_t HeapMemoryUsage() const { return deduplicated_.HeapMemoryUsage(); }
+
  private:
   template <typename CRTP, typename F>
   // NOLINTNEXTLINE(readability-redundant-declaration)
@@ -61,4 +63,5 @@ struct ExtraFeatureConstView<Deduplicate<Feature>, CRTP> {
 template <typename Feature, typename CRTP>
 struct ExtraFeatureMutableView<Deduplicate<Feature>, CRTP> {
   std::pair<const Feature*, bool> AddDeduplicated(const Feature& feature) const;
+  std::pair<const Feature*, bool> AddDeduplicated(Feature&& feature) const;
 };
@@ -37,6 +37,8 @@ struct ElementStorage {
   template <typename F>
   auto GetFeatureStorage() const;
 
+  const std::tuple<Fs...>& GetFeaturesStorage() const { return features_storage_; }
+
  private:
   std::tuple<Fs...> features_storage_;
 };
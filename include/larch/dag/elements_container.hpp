@@ -73,6 +73,12 @@ struct ElementsContainer {
   template <typename Feature>
   auto GetFeatureExtraStorage() const;
 
+  /**
+   * Bytes used by each per-element and extra feature, including heap memory
+   * owned by the features.
+   */
+  MemoryUsageReport MemoryUsage() const;
+
   template <typename VT>
   auto All() const {
     return ranges::views::iota(size_t{0}, GetCount<VT>()) |
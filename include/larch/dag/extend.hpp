@@ -287,6 +287,12 @@ struct ExtendDAGStorage {
   auto& GetTargetStorage() { return *this; }
   auto& GetTargetStorage() const { return *this; }
 
+  /**
+   * Bytes used by the added features, plus the target DAG's usage when the
+   * target storage is owned.
+   */
+  MemoryUsageReport MemoryUsage() const;
+
   explicit ExtendDAGStorage(Target&& target);
 
  private:
@@ -60,6 +60,11 @@ struct DAGNeighbors : Neighbors {
     return leafs_below_;
   }
 
+  size_t HeapMemoryUsage() const {
+    return ::HeapMemoryUsage(parents_) + ::HeapMemoryUsage(clades_) +
+           ::HeapMemoryUsage(leafs_below_);
+  }
+
  private:
   std::vector<EdgeId> parents_;
   std::vector<std::vector<EdgeId>> clades_;
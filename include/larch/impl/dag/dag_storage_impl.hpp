@@ -193,6 +193,17 @@ auto DAGStorage<ShortName, NodesContainerT, EdgesContainerT, ExtraStorageT,
   return features_storage_.template GetFeatureStorage<Feature>();
 }
 
+template <typename ShortName, typename NodesContainerT, typename EdgesContainerT,
+          typename ExtraStorageT, template <typename, typename> typename ViewBase>
+MemoryUsageReport DAGStorage<ShortName, NodesContainerT, EdgesContainerT, ExtraStorageT,
+                             ViewBase>::MemoryUsage() const {
+  MemoryUsageReport result;
+  result.Add("nodes", nodes_container_.MemoryUsage());
+  result.Add("edges", edges_container_.MemoryUsage());
+  result.Add("dag", features_storage_.MemoryUsage());
+  return result;
+}
+
 struct DefaultDAGStorage;
 
 template <>
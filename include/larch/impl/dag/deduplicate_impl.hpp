@@ -84,3 +84,20 @@ ExtraFeatureMutableView<Deduplicate<Feature>, CRTP>::AddDeduplicated(
   });
   return {std::addressof(result.first), result.second};
 }
+
+template <typename Feature, typename CRTP>
+std::pair<const Feature*, bool>
+ExtraFeatureMutableView<Deduplicate<Feature>, CRTP>::AddDeduplicated(
+    Feature&& feature) const {
+  constexpr auto C =
+      CRTP::template contains_element_feature<Component::Node, Deduplicate<Feature>>
+          ? Component::Node
+          : Component::Edge;
+  auto& deduplicated = static_cast<const CRTP&>(*this)
+                           .template GetFeatureExtraStorage<C, Deduplicate<Feature>>()
+                           .get()
+                           .deduplicated_;
+
+  auto result = deduplicated.insert(std::move(feature));
+  return {std::addressof(result.first), result.second};
+}
@@ -48,6 +48,39 @@ void ElementsContainer<C, ElementStorageT, IdCont, Features...>::Clear() {
   features_storage_.clear();
 }
 
+template <Component C, typename ElementStorageT, IdContinuity IdCont,
+          typename... Features>
+MemoryUsageReport
+ElementsContainer<C, ElementStorageT, IdCont, Features...>::MemoryUsage() const {
+  auto value = [](const auto& i) -> const auto& {
+    if constexpr (IdCont == IdContinuity::Dense) {
+      return i;
+    } else {
+      return i.second;
+    }
+  };
+  FeaturesMemoryUsage<typename ElementStorageT::FeatureTypes> element_features;
+  for (auto& i : elements_storage_) {
+    element_features.Accumulate(value(i).GetFeaturesStorage());
+  }
+  FeaturesMemoryUsage<Features...> container_features;
+  for (auto& i : features_storage_) {
+    container_features.Accumulate(value(i));
+  }
+  FeaturesMemoryUsage<decltype(extra_features_storage_)> extra_features;
+  extra_features.Accumulate(extra_features_storage_);
+  FeaturesMemoryUsage<decltype(elements_extra_features_storage_)>
+      elements_extra_features;
+  elements_extra_features.Accumulate(elements_extra_features_storage_);
+
+  MemoryUsageReport result;
+  element_features.AddTo(result);
+  container_features.AddTo(result);
+  extra_features.AddTo(result);
+  elements_extra_features.AddTo(result);
+  return result;
+}
+
 template <Component C, typename ElementStorageT, IdContinuity IdCont,
           typename... Features>
 template <typename Feature, typename E>
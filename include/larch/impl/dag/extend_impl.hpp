@@ -296,6 +296,54 @@ auto ExtendDAGStorage<ShortName, Target, Arg0, Arg1, Arg2, ViewBase,
   }
 }
 
+template <typename ShortName, typename Target, typename Arg0, typename Arg1,
+          typename Arg2, template <typename, typename> typename ViewBase,
+          IdContinuity Cont>
+MemoryUsageReport
+ExtendDAGStorage<ShortName, Target, Arg0, Arg1, Arg2, ViewBase, Cont>::MemoryUsage()
+    const {
+  MemoryUsageReport result;
+  if constexpr (Target::role == Role::Storage) {
+    result = target_.MemoryUsage();
+  }
+  auto value = [](const auto& i) -> const auto& {
+    if constexpr (Cont == IdContinuity::Dense) {
+      return i;
+    } else {
+      return i.second;
+    }
+  };
+
+  MemoryUsageReport nodes;
+  FeaturesMemoryUsage<typename OnNodes::FeatureTypes> node_features;
+  for (auto& i : additional_node_features_storage_) {
+    node_features.Accumulate(value(i));
+  }
+  node_features.AddTo(nodes);
+  FeaturesMemoryUsage<typename OnNodes::ExtraStorage> node_extra_features;
+  node_extra_features.Accumulate(additional_node_extra_features_storage_);
+  node_extra_features.AddTo(nodes);
+  result.Add("nodes", nodes);
+
+  MemoryUsageReport edges;
+  FeaturesMemoryUsage<typename OnEdges::FeatureTypes> edge_features;
+  for (auto& i : additional_edge_features_storage_) {
+    edge_features.Accumulate(value(i));
+  }
+  edge_features.AddTo(edges);
+  FeaturesMemoryUsage<typename OnEdges::ExtraStorage> edge_extra_features;
+  edge_extra_features.Accumulate(additional_edge_extra_features_storage_);
+  edge_extra_features.AddTo(edges);
+  result.Add("edges", edges);
+
+  MemoryUsageReport dag;
+  FeaturesMemoryUsage<typename OnDAG::Storage> dag_features;
+  dag_features.Accumulate(additional_dag_features_storage_);
+  dag_features.AddTo(dag);
+  result.Add("dag", dag);
+  return result;
+}
+
 template <typename ShortName, typename Target, typename Arg0, typename Arg1,
           typename Arg2, template <typename, typename> typename ViewBase,
           IdContinuity Cont>
@@ -7,46 +7,67 @@ static inline void AssertMut(MutationPosition, [[maybe_unused]] MutationBase mut
   Assert(mut == 'A' or mut == 'C' or mut == 'G' or mut == 'T' or mut == 'N');
 }
 
-static void ComputeMutations(const EdgeMutations& edge_mutations,
-                             std::string_view reference_sequence,
-                             ContiguousMap<MutationPosition, MutationBase>& result) {
+/**
+ * Apply edge mutations to the parent's mutations. Calls on_removed and on_added
+ * for every (position, base) that is replaced or added, so that callers can
+ * update the hash incrementally.
+ */
+template <typename OnRemoved, typename OnAdded>
+static PackedMap<MutationPosition, MutationBase> ComputeMutations(
+    const EdgeMutations& edge_mutations, std::string_view reference_sequence,
+    const PackedMap<MutationPosition, MutationBase>& parent_mutations,
+    OnRemoved&& on_removed, OnAdded&& on_added) {
+  PackedMap<MutationPosition, MutationBase> result;
+  result.reserve(parent_mutations.size() + edge_mutations.size());
+  auto parent_it = parent_mutations.begin();
   for (auto [pos, nucs] : edge_mutations) {
-    const bool is_valid = nucs.second != reference_sequence.at(pos.value - 1);
-    auto it = result.find(pos);
-    if (it != result.end() and it->first == pos) {
-      if (is_valid) {
-        AssertMut(pos, nucs.second);
-        it->second = nucs.second;
-      } else {
-        result.erase(it);
-      }
-    } else {
-      if (is_valid) {
-        AssertMut(pos, nucs.second);
-        result.insert_or_assign(pos, nucs.second);
+    for (; parent_it != parent_mutations.end(); ++parent_it) {
+      auto [parent_pos, parent_base] = *parent_it;
+      if (not(parent_pos < pos)) {
+        if (parent_pos == pos) {
+          // overwritten or reverted by the edge
+          on_removed(parent_pos, parent_base);
+          ++parent_it;
+        }
+        break;
       }
+      result.push_back(parent_pos, parent_base);
+    }
+    if (nucs.second != reference_sequence.at(pos.value - 1)) {
+      AssertMut(pos, nucs.second);
+      result.push_back(pos, nucs.second);
+      on_added(pos, nucs.second);
     }
   }
+  for (; parent_it != parent_mutations.end(); ++parent_it) {
+    auto [parent_pos, parent_base] = *parent_it;
+    result.push_back(parent_pos, parent_base);
+  }
+  return result;
 }
 
-CompactGenome::CompactGenome(ContiguousMap<MutationPosition, MutationBase>&& mutations)
-    : mutations_{std::move(mutations)}, hash_{ComputeHash(mutations_)} {
-#ifdef KEEP_ASSERTS
-  for (auto [pos, mut] : mutations_) {
+static PackedMap<MutationPosition, MutationBase> ToPackedMutations(
+    ContiguousMap<MutationPosition, MutationBase>&& mutations) {
+  PackedMap<MutationPosition, MutationBase> result;
+  result.reserve(mutations.size());
+  for (auto [pos, mut] : mutations) {
     AssertMut(pos, mut);
+    result.push_back(pos, mut);
   }
-#endif
+  return result;
 }
 
+CompactGenome::CompactGenome(ContiguousMap<MutationPosition, MutationBase>&& mutations)
+    : mutations_{ToPackedMutations(std::move(mutations))},
+      hash_{ComputeHash(mutations_)} {}
+
 CompactGenome::CompactGenome(ContiguousMap<MutationPosition, MutationBase>&& mutations,
                              size_t hash)
-    : mutations_{std::move(mutations)}, hash_{hash} {
-#ifdef KEEP_ASSERTS
-  for (auto [pos, mut] : mutations_) {
-    AssertMut(pos, mut);
-  }
-#endif
-}
+    : mutations_{ToPackedMutations(std::move(mutations))}, hash_{hash} {}
+
+CompactGenome::CompactGenome(PackedMap<MutationPosition, MutationBase>&& mutations,
+                             size_t hash)
+    : mutations_{std::move(mutations)}, hash_{hash} {}
 
 CompactGenome::CompactGenome(const std::string& sequence,
                              const std::string& reference_sequence) {
@@ -54,7 +75,7 @@ CompactGenome::CompactGenome(const std::string& sequence,
   for (size_t i = 0; i < sequence.size(); i++) {
     if (sequence[i] != reference_sequence[i]) {
       AssertMut({i + 1}, {sequence[i]});
-      mutations_.insert({{i + 1}, {sequence[i]}});
+      mutations_.push_back({i + 1}, {sequence[i]});
     }
   }
   hash_ = ComputeHash(mutations_);
@@ -63,49 +84,70 @@ CompactGenome::CompactGenome(const std::string& sequence,
 void CompactGenome::AddParentEdge(const EdgeMutations& mutations,
                                   const CompactGenome& parent,
                                   std::string_view reference_sequence) {
-  mutations_.Union(parent.mutations_);
-  ComputeMutations(mutations, reference_sequence, mutations_);
-  hash_ = ComputeHash(mutations_);
+  if (not mutations_.empty()) {
+    // uncommon: combine with existing mutations and rehash everything
+    mutations_.Union(parent.mutations_);
+    mutations_ = ComputeMutations(
+        mutations, reference_sequence, mutations_, [](auto, auto) {},
+        [](auto, auto) {});
+    hash_ = ComputeHash(mutations_);
+    return;
+  }
+  // The hash is a sum over mutations, so only the edge's mutations need to be
+  // rehashed.
+  size_t hash = parent.hash_;
+  mutations_ = ComputeMutations(
+      mutations, reference_sequence, parent.mutations_,
+      [&hash](MutationPosition pos, MutationBase base) {
+        hash -= MutationHash(pos, base);
+      },
+      [&hash](MutationPosition pos, MutationBase base) {
+        hash += MutationHash(pos, base);
+      });
+  hash_ = hash;
 }
 
 void CompactGenome::ApplyChanges(
     const ContiguousMap<MutationPosition, MutationBase>& changes) {
   for (auto change : changes) {
     AssertMut(change.first, change.second);
+    auto it = mutations_.find(change.first);
+    if (it != mutations_.end()) {
+      hash_ -= MutationHash(change.first, mutations_.GetValue(it.GetIndex()));
+    }
+    hash_ += MutationHash(change.first, change.second);
     mutations_.insert_or_assign(change.first, change.second);
   }
 }
 
 bool CompactGenome::HasMutationAtPosition(MutationPosition pos) const {
-  auto it = mutations_.find(pos);
-  return (it != mutations_.end() and it->first == pos);
+  return mutations_.Contains(pos);
 }
 
 MutationBase CompactGenome::GetBase(MutationPosition pos,
                                     std::string_view reference_sequence) const {
   auto it = mutations_.find(pos);
-  if (it != mutations_.end() and it->first == pos) {
-    return it->second;
+  if (it != mutations_.end()) {
+    return mutations_.GetValue(it.GetIndex());
   }
   return reference_sequence.at(pos.value - 1);
 }
 
 ContiguousSet<MutationPosition> CompactGenome::DifferingSites(
     const CompactGenome& other) const {
-  ContiguousSet<MutationPosition> result;
-  for (auto [pos, base] : mutations_) {
-    auto it = other.mutations_.find(pos);
-    if (it == other.mutations_.end() or !it->second.IsCompatible(base)) {
-      result.insert(pos);
-    }
-  }
-  for (auto [pos, base] : other.mutations_) {
-    auto it = mutations_.find(pos);
-    if (it == mutations_.end() or !it->second.IsCompatible(base)) {
-      result.insert(pos);
-    }
-  }
-  return result;
+  const auto& lhs_pos = mutations_.GetKeys();
+  const auto& rhs_pos = other.mutations_.GetKeys();
+  std::vector<MutationPosition> result;
+  MergeSortedUnique(
+      lhs_pos.data(), lhs_pos.size(), rhs_pos.data(), rhs_pos.size(),
+      [&](size_t lhs) { result.push_back({lhs_pos[lhs]}); },
+      [&](size_t rhs) { result.push_back({rhs_pos[rhs]}); },
+      [&](size_t lhs, size_t rhs) {
+        if (not mutations_.GetValue(lhs).IsCompatible(other.mutations_.GetValue(rhs))) {
+          result.push_back({lhs_pos[lhs]});
+        }
+      });
+  return {result.begin(), result.end()};
 }
 
 bool CompactGenome::operator==(const CompactGenome& rhs) const noexcept {
@@ -125,6 +167,13 @@ bool CompactGenome::operator<(const CompactGenome& rhs) const noexcept {
 
 bool CompactGenome::IsCompatible(const CompactGenome& rhs,
                                  std::string_view reference_sequence) const {
+  // at the same sites, as leaves called against the same sites often are, the
+  // packed bases are compared directly without the reference
+  if (mutations_.GetKeys() == rhs.mutations_.GetKeys()) {
+    return PackedBases::AllCompatible(mutations_.GetPackedValues().data(),
+                                      rhs.mutations_.GetPackedValues().data(),
+                                      mutations_.size());
+  }
   const auto& lhs = *this;
   for (auto [pos, mut] : lhs) {
     if (!rhs.GetBase(pos, reference_sequence)
@@ -145,20 +194,16 @@ bool CompactGenome::IsCompatible(const CompactGenome& rhs,
 }
 
 bool CompactGenome::ContainsAmbiguity() const {
-  for (auto [pos, base] : mutations_) {  // NOLINT(readability-use-anyofallof)
-    if (base.IsAmbiguous()) {
-      return true;
-    }
-  }
-  return false;
+  return PackedBases::CountAmbiguous(mutations_.GetPackedValues().data(),
+                                     mutations_.size()) > 0;
 }
 
 size_t CompactGenome::Hash() const noexcept { return hash_; }
 
 std::optional<MutationBase> CompactGenome::operator[](MutationPosition pos) const {
   auto it = mutations_.find(pos);
-  if (it != mutations_.end() and it->first == pos) {
-    return it->second;
+  if (it != mutations_.end()) {
+    return mutations_.GetValue(it.GetIndex());
   }
   return std::nullopt;
 }
@@ -173,6 +218,8 @@ auto CompactGenome::end() const -> decltype(mutations_.end()) {
 
 bool CompactGenome::empty() const { return mutations_.empty(); }
 
+size_t CompactGenome::HeapMemoryUsage() const { return mutations_.HeapMemoryUsage(); }
+
 template <typename CRTP>
 CompactGenome CompactGenome::Copy(const CRTP*) const {
   CompactGenome result{mutations_.Copy(), hash_};
@@ -201,37 +248,50 @@ std::string CompactGenome::ToSequence(std::string_view reference_sequence) const
 EdgeMutations CompactGenome::ToEdgeMutations(std::string_view reference_sequence,
                                              const CompactGenome& parent,
                                              const CompactGenome& child) {
-  EdgeMutations result;
-  for (auto [pos, child_base] : child) {
-    MutationBase parent_base = reference_sequence.at(pos.value - 1);
-    auto opt_parent_base = parent[pos];
-    if (opt_parent_base.has_value()) {
-      parent_base = opt_parent_base.value();
-    }
-    if (!parent_base.IsCompatible(child_base)) {
-      result[pos] = {parent_base, child_base.GetFirstBase()};
+  using Mutation = std::pair<MutationPosition, std::pair<MutationBase, MutationBase>>;
+  const auto& parent_pos = parent.mutations_.GetKeys();
+  const auto& child_pos = child.mutations_.GetKeys();
+  std::vector<Mutation> result;
+  auto add = [&result](std::uint32_t pos, MutationBase parent_base,
+                       MutationBase child_base) {
+    if (not parent_base.IsCompatible(child_base)) {
+      result.push_back({{pos}, {parent_base, child_base.GetFirstBase()}});
     }
-  }
+  };
+  MergeSortedUnique(
+      parent_pos.data(), parent_pos.size(), child_pos.data(), child_pos.size(),
+      [&](size_t idx) {
+        add(parent_pos[idx], parent.mutations_.GetValue(idx),
+            reference_sequence.at(parent_pos[idx] - 1));
+      },
+      [&](size_t idx) {
+        add(child_pos[idx], reference_sequence.at(child_pos[idx] - 1),
+            child.mutations_.GetValue(idx));
+      },
+      [&](size_t parent_idx, size_t child_idx) {
+        add(parent_pos[parent_idx], parent.mutations_.GetValue(parent_idx),
+            child.mutations_.GetValue(child_idx));
+      });
+  // the kernel reports each category in order, but not interleaved by position
+  std::sort(result.begin(), result.end(), [](const Mutation& lhs, const Mutation& rhs) {
+    return lhs.first < rhs.first;
+  });
+  return EdgeMutations{result};
+}
 
-  for (auto [pos, parent_base] : parent) {
-    MutationBase child_base = reference_sequence.at(pos.value - 1);
-    auto opt_child_base = child[pos];
-    if (opt_child_base.has_value()) {
-      child_base = opt_child_base.value();
-    }
-    if (!child_base.IsCompatible(parent_base)) {
-      result[pos] = {parent_base, child_base.GetFirstBase()};
-    }
-  }
-  return result;
+size_t CompactGenome::MutationHash(MutationPosition pos, MutationBase base) {
+  // mixed, so that sums of hashes of different mutations don't collide easily
+  const size_t key = (pos.value << 8) | static_cast<unsigned char>(base.ToChar());
+  return SplitMix64(key + 0x9e3779b97f4a7c15);
 }
 
 size_t CompactGenome::ComputeHash(
-    const ContiguousMap<MutationPosition, MutationBase>& mutations) {
+    const PackedMap<MutationPosition, MutationBase>& mutations) {
+  // order independent, so that AddParentEdge and ApplyChanges can update it
+  // one mutation at a time
   size_t result = 0;
   for (auto [pos, base] : mutations) {
-    result = HashCombine(result, pos.value);
-    result = HashCombine(result, static_cast<size_t>(base.ToChar()));
+    result += MutationHash(pos, base);
   }
   return result;
 }
@@ -0,0 +1,182 @@
+DeltaCompactGenome::const_iterator::const_iterator(const Link* link) {
+  for (; link != nullptr; link = link->parent.get()) {
+    if (not link->delta.empty()) {
+      levels_.push_back({&link->delta, 0});
+    }
+  }
+  ++*this;
+}
+
+DeltaCompactGenome::const_iterator& DeltaCompactGenome::const_iterator::operator++() {
+  while (not levels_.empty()) {
+    std::uint32_t pos = std::numeric_limits<std::uint32_t>::max();
+    for (auto& level : levels_) {
+      pos = std::min(pos, level.delta->GetKeys()[level.index]);
+    }
+    // the shallowest level holding the position overrides the deeper ones
+    std::optional<MutationBase> base;
+    for (auto& level : levels_) {
+      if (level.delta->GetKeys()[level.index] == pos) {
+        if (not base.has_value()) {
+          base = level.delta->GetValue(level.index);
+        }
+        ++level.index;
+      }
+    }
+    levels_.erase(std::remove_if(levels_.begin(), levels_.end(),
+                                 [](const Level& level) {
+                                   return level.index == level.delta->size();
+                                 }),
+                  levels_.end());
+    if (*base != MutationBase{}) {
+      current_ = {{pos}, *base};
+      done_ = false;
+      return *this;
+    }
+  }
+  done_ = true;
+  return *this;
+}
+
+DeltaCompactGenome::DeltaCompactGenome(const CompactGenome& genome) {
+  auto link = std::make_shared<Link>();
+  for (auto [pos, base] : genome) {
+    link->delta.push_back(pos, base);
+  }
+  link_ = std::move(link);
+}
+
+DeltaCompactGenome::DeltaCompactGenome(const DeltaCompactGenome& parent,
+                                       const EdgeMutations& mutations,
+                                       std::string_view reference_sequence,
+                                       size_t checkpoint_interval) {
+  auto link = std::make_shared<Link>();
+  if (parent.GetDepth() + 1 >= checkpoint_interval) {
+    // checkpoint: store all differences from the reference
+    ContiguousMap<MutationPosition, MutationBase> full;
+    for (auto [pos, base] : parent) {
+      full.insert({pos, base});
+    }
+    for (auto [pos, nucs] : mutations) {
+      if (nucs.second != reference_sequence.at(pos.value - 1)) {
+        full.insert_or_assign(pos, nucs.second);
+      } else if (auto it = full.find(pos); it != full.end()) {
+        full.erase(it);
+      }
+    }
+    link->delta.reserve(full.size());
+    for (auto [pos, base] : full) {
+      link->delta.push_back(pos, base);
+    }
+  } else {
+    link->parent = parent.link_;
+    link->depth = parent.GetDepth() + 1;
+    link->delta.reserve(mutations.size());
+    for (auto [pos, nucs] : mutations) {
+      if (nucs.second != reference_sequence.at(pos.value - 1)) {
+        link->delta.push_back(pos, nucs.second);
+      } else if (parent.HasMutationAtPosition(pos)) {
+        link->delta.push_back(pos, MutationBase{});
+      }
+    }
+  }
+  link_ = std::move(link);
+}
+
+DeltaCompactGenome::const_iterator DeltaCompactGenome::begin() const {
+  return const_iterator{link_.get()};
+}
+
+DeltaCompactGenome::const_iterator DeltaCompactGenome::end() const { return {}; }
+
+bool DeltaCompactGenome::empty() const { return begin() == end(); }
+
+std::optional<MutationBase> DeltaCompactGenome::operator[](MutationPosition pos) const {
+  for (const Link* link = link_.get(); link != nullptr; link = link->parent.get()) {
+    auto it = link->delta.find(pos);
+    if (it != link->delta.end()) {
+      MutationBase base = link->delta.GetValue(it.GetIndex());
+      if (base == MutationBase{}) {
+        return std::nullopt;
+      }
+      return base;
+    }
+  }
+  return std::nullopt;
+}
+
+bool DeltaCompactGenome::HasMutationAtPosition(MutationPosition pos) const {
+  return (*this)[pos].has_value();
+}
+
+MutationBase DeltaCompactGenome::GetBase(MutationPosition pos,
+                                         std::string_view reference_sequence) const {
+  return (*this)[pos].value_or(reference_sequence.at(pos.value - 1));
+}
+
+bool DeltaCompactGenome::operator==(const DeltaCompactGenome& rhs) const {
+  if (link_ == rhs.link_) {
+    return true;
+  }
+  auto lhs_it = begin();
+  auto rhs_it = rhs.begin();
+  for (; lhs_it != end() and rhs_it != rhs.end(); ++lhs_it, ++rhs_it) {
+    if (*lhs_it != *rhs_it) {
+      return false;
+    }
+  }
+  return lhs_it == end() and rhs_it == rhs.end();
+}
+
+bool DeltaCompactGenome::operator!=(const DeltaCompactGenome& rhs) const {
+  return not(*this == rhs);
+}
+
+size_t DeltaCompactGenome::GetDepth() const {
+  return link_ == nullptr ? 0 : link_->depth;
+}
+
+CompactGenome DeltaCompactGenome::ToCompactGenome() const {
+  ContiguousMap<MutationPosition, MutationBase> result;
+  for (auto [pos, base] : *this) {
+    result.insert({pos, base});
+  }
+  return CompactGenome{std::move(result)};
+}
+
+size_t DeltaCompactGenome::HeapMemoryUsage() const {
+  return link_ == nullptr ? 0 : sizeof(Link) + link_->delta.HeapMemoryUsage();
+}
+
+template <typename DAG>
+IdContainer<NodeId, DeltaCompactGenome, IdContinuity::Dense> ComputeDeltaCompactGenomes(
+    DAG dag, size_t checkpoint_interval) {
+  const std::string_view reference_sequence = dag.GetReferenceSequence();
+  IdContainer<NodeId, DeltaCompactGenome, IdContinuity::Dense> result;
+  result.resize(dag.GetNodesCount());
+  std::vector<bool> computed(dag.GetNodesCount(), false);
+  std::vector<NodeId> path;
+  for (auto node : dag.GetNodes()) {
+    // walk up first parents to the nearest computed ancestor, then compute
+    // genomes downwards, without recursion on deep lineages
+    for (auto current = node; not computed.at(current.GetId().value);
+         current = current.GetFirstParent().GetParent()) {
+      path.push_back(current.GetId());
+      if (current.IsUA()) {
+        break;
+      }
+    }
+    for (auto id : path | ranges::views::reverse) {
+      auto current = dag.Get(id);
+      if (not current.IsUA()) {
+        auto edge = current.GetFirstParent();
+        result.at(id) = DeltaCompactGenome{result.at(edge.GetParentId()),
+                                           edge.GetEdgeMutations(), reference_sequence,
+                                           checkpoint_interval};
+      }
+      computed.at(id.value) = true;
+    }
+    path.clear();
+  }
+  return result;
+}
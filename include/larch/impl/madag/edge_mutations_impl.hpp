@@ -19,7 +19,7 @@ EdgeMutations::EdgeMutations(T&& mutations_view,
 }
 
 EdgeMutations::EdgeMutations(
-    ContiguousMap<MutationPosition, std::pair<MutationBase, MutationBase>>&& mutations)
+    PackedMap<MutationPosition, std::pair<MutationBase, MutationBase>>&& mutations)
     : mutations_{std::forward<decltype(mutations_)>(mutations)} {}
 
 template <typename CRTP>
@@ -39,6 +39,16 @@ size_t EdgeMutations::size() const { return mutations_.size(); }
 
 bool EdgeMutations::empty() const { return mutations_.empty(); }
 
+const std::vector<std::uint32_t>& EdgeMutations::GetPositions() const {
+  return mutations_.GetKeys();
+}
+
+const std::vector<std::uint8_t>& EdgeMutations::GetPackedBases() const {
+  return mutations_.GetPackedValues();
+}
+
+size_t EdgeMutations::HeapMemoryUsage() const { return mutations_.HeapMemoryUsage(); }
+
 auto EdgeMutations::operator[](MutationPosition pos) -> decltype(mutations_[pos]) {
   Assert(pos.value != NoId);
   return mutations_[pos];
@@ -56,9 +66,7 @@ bool EdgeMutations::HasMutationAtPosition(MutationPosition pos) const {
 
 std::pair<MutationBase, MutationBase> EdgeMutations::GetMutation(
     MutationPosition pos) const {
-  auto it = mutations_.find(pos);
-  Assert(it != mutations_.end() and it->first == pos);
-  return it->second;
+  return mutations_.at(pos);
 }
 
 bool EdgeMutations::operator==(const EdgeMutations& rhs) const {
@@ -0,0 +1,140 @@
+#include <numeric>
+
+template <typename CRTP>
+DAGNeighbors FrozenNeighbors::Copy(const CRTP* crtp) const {
+  DAGNeighbors result;
+  result.GetParentsMutable(crtp) = ranges::to_vector(GetParents(crtp));
+  for (auto clade : GetClades(crtp)) {
+    result.GetCladesMutable(crtp).push_back(ranges::to_vector(clade));
+  }
+  for (auto leafs : GetLeafsBelow(crtp)) {
+    result.GetLeafsBelowMutable(crtp).push_back(ranges::to_vector(leafs));
+  }
+  return result;
+}
+
+template <typename CRTP>
+auto FrozenNeighbors::GetParents(const CRTP* crtp) const {
+  auto& storage = crtp->template GetFeatureExtraStorage<FrozenNeighbors>().get();
+  const size_t id = crtp->GetId().value;
+  const EdgeId* parents = storage.parents_.data();
+  return ranges::make_subrange(parents + storage.parents_offsets_[id],
+                               parents + storage.parents_offsets_[id + 1]);
+}
+
+template <typename CRTP>
+auto FrozenNeighbors::GetClades(const CRTP* crtp) const {
+  auto& storage = crtp->template GetFeatureExtraStorage<FrozenNeighbors>().get();
+  const size_t id = crtp->GetId().value;
+  const EdgeId* children = storage.children_.data();
+  const size_t* offsets = storage.children_offsets_.data();
+  return ranges::views::iota(storage.clades_offsets_[id],
+                             storage.clades_offsets_[id + 1]) |
+         ranges::views::transform([children, offsets](size_t clade) {
+           return ranges::make_subrange(children + offsets[clade],
+                                        children + offsets[clade + 1]);
+         });
+}
+
+template <typename CRTP>
+auto FrozenNeighbors::GetLeafsBelow(const CRTP* crtp) const {
+  auto& storage = crtp->template GetFeatureExtraStorage<FrozenNeighbors>().get();
+  const size_t id = crtp->GetId().value;
+  const NodeId* leafs = storage.leafs_below_.data();
+  const size_t* offsets = storage.leafs_offsets_.data();
+  return ranges::views::iota(storage.leafs_below_offsets_[id],
+                             storage.leafs_below_offsets_[id + 1]) |
+         ranges::views::transform([leafs, offsets](size_t clade) {
+           return ranges::make_subrange(leafs + offsets[clade],
+                                        leafs + offsets[clade + 1]);
+         });
+}
+
+template <typename DAG>
+FrozenDAGStorage FreezeDAG(DAG dag) {
+  const size_t nodes_count = dag.GetNodesCount();
+  const size_t edges_count = dag.GetEdgesCount();
+
+  FrozenDAGStorage result = FrozenDAGStorage::EmptyDefault();
+  auto frozen = result.View();
+  frozen.SetReferenceSequence(dag.GetInternedReferenceSequence());
+  frozen.InitializeNodes(nodes_count);
+  frozen.InitializeEdges(edges_count);
+
+  auto& storage =
+      result.template GetFeatureExtraStorage<Component::Node, FrozenNeighbors>().get();
+  auto prefix_sum = [](std::vector<size_t>& offsets) {
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  };
+
+  // First pass: count per-node parents, clades and leaf clades.
+  storage.parents_offsets_.assign(nodes_count + 1, 0);
+  storage.clades_offsets_.assign(nodes_count + 1, 0);
+  storage.leafs_below_offsets_.assign(nodes_count + 1, 0);
+  ParallelForEach(dag.GetNodes(), [&](auto node) {
+    const size_t id = node.GetId().value;
+    Assert(id < nodes_count);
+    storage.parents_offsets_[id + 1] = node.GetParentsCount();
+    storage.clades_offsets_[id + 1] = node.GetCladesCount();
+    storage.leafs_below_offsets_[id + 1] =
+        static_cast<size_t>(ranges::distance(node.GetLeafsBelow()));
+  });
+  prefix_sum(storage.parents_offsets_);
+  prefix_sum(storage.clades_offsets_);
+  prefix_sum(storage.leafs_below_offsets_);
+
+  // Second pass: fill parents, count per-clade children and leafs.
+  storage.parents_.resize(storage.parents_offsets_.back());
+  storage.children_offsets_.assign(storage.clades_offsets_.back() + 1, 0);
+  storage.leafs_offsets_.assign(storage.leafs_below_offsets_.back() + 1, 0);
+  ParallelForEach(dag.GetNodes(), [&](auto node) {
+    const size_t id = node.GetId().value;
+    size_t parent_idx = storage.parents_offsets_[id];
+    for (auto parent : node.GetParents()) {
+      storage.parents_[parent_idx++] = parent.GetId();
+    }
+    size_t clade_idx = storage.clades_offsets_[id];
+    for (auto clade : node.GetClades()) {
+      storage.children_offsets_[++clade_idx] = static_cast<size_t>(clade.size());
+    }
+    size_t leafs_idx = storage.leafs_below_offsets_[id];
+    for (auto leafs : node.GetLeafsBelow()) {
+      storage.leafs_offsets_[++leafs_idx] = static_cast<size_t>(leafs.size());
+    }
+  });
+  prefix_sum(storage.children_offsets_);
+  prefix_sum(storage.leafs_offsets_);
+
+  // Third pass: fill children, leafs and per-node features.
+  storage.children_.resize(storage.children_offsets_.back());
+  storage.leafs_below_.resize(storage.leafs_offsets_.back());
+  ParallelForEach(dag.GetNodes(), [&](auto node) {
+    const size_t id = node.GetId().value;
+    size_t clade_idx = storage.clades_offsets_[id];
+    for (auto clade : node.GetClades()) {
+      size_t child_idx = storage.children_offsets_[clade_idx++];
+      for (auto child : clade) {
+        storage.children_[child_idx++] = child.GetId();
+      }
+    }
+    size_t leafs_idx = storage.leafs_below_offsets_[id];
+    for (auto leafs : node.GetLeafsBelow()) {
+      size_t leaf_idx = storage.leafs_offsets_[leafs_idx++];
+      for (auto leaf : leafs) {
+        storage.leafs_below_[leaf_idx++] = leaf.GetId();
+      }
+    }
+    auto frozen_node = frozen.Get(node.GetId());
+    frozen_node = std::addressof(node.GetCompactGenome());
+    frozen_node.SetSampleId(node.GetSampleId());
+  });
+
+  ParallelForEach(dag.GetEdges(), [&](auto edge) {
+    auto frozen_edge = frozen.Get(edge.GetId());
+    frozen_edge.Set(edge.GetParentId(), edge.GetChildId(), edge.GetClade());
+    frozen_edge.SetEdgeMutations(edge.GetEdgeMutations().Copy(&frozen_edge));
+  });
+
+  frozen.BuildRootAndLeafs();
+  return result;
+}
@@ -1,6 +1,12 @@
 template <typename CRTP, typename Tag>
 const std::string&
 FeatureConstView<ReferenceSequence, CRTP, Tag>::GetReferenceSequence() const {
+  return GetFeatureStorage(this).get().reference_sequence_.get();
+}
+
+template <typename CRTP, typename Tag>
+const InternedSequence&
+FeatureConstView<ReferenceSequence, CRTP, Tag>::GetInternedReferenceSequence() const {
   return GetFeatureStorage(this).get().reference_sequence_;
 }
 
@@ -23,6 +29,13 @@ bool FeatureConstView<ReferenceSequence, CRTP, Tag>::HaveUA() const {
 template <typename CRTP, typename Tag>
 void FeatureMutableView<ReferenceSequence, CRTP, Tag>::SetReferenceSequence(
     std::string_view reference_sequence) const {
+  GetFeatureStorage(this).get().reference_sequence_ =
+      InternedSequence::Intern(reference_sequence);
+}
+
+template <typename CRTP, typename Tag>
+void FeatureMutableView<ReferenceSequence, CRTP, Tag>::SetReferenceSequence(
+    const InternedSequence& reference_sequence) const {
   GetFeatureStorage(this).get().reference_sequence_ = reference_sequence;
 }
 
@@ -110,37 +123,104 @@ void FeatureMutableView<ReferenceSequence, CRTP, Tag>::RecomputeCompactGenomes(
     bool recompute_leaves) const {
   auto dag = static_cast<const CRTP&>(*this);
   using Node = typename decltype(dag)::NodeView;
-  using Edge = typename decltype(dag)::EdgeView;
+  constexpr size_t NoSlot = std::numeric_limits<size_t>::max();
 
+  // Assign a slot to every node to recompute and to its first-parent
+  // ancestors, parents before children. The walk up is iterative, so deep
+  // trees don't overflow the stack.
   auto max_id = dag.GetNodesCount();
   for (auto node : dag.GetNodes()) {
     max_id = max_id > node.GetId().value ? max_id : node.GetId().value;
   }
-  IdContainer<NodeId, CompactGenome, Cont> new_cgs;
-  new_cgs.resize(max_id + 1);
-  auto ComputeCG = [&new_cgs, dag](auto& self, Node for_node) {
-    CompactGenome& compact_genome = new_cgs.at(for_node.GetId());
-    if (for_node.IsUA()) {
-      compact_genome = {};
-      return;
+  std::vector<size_t> slots(max_id + 1, NoSlot);
+  std::vector<NodeId> nodes;
+  std::vector<size_t> parent_slots;
+  std::vector<size_t> depths;
+  std::vector<NodeId> path;
+  for (Node node : dag.GetNodes()) {
+    if (not(recompute_leaves or not node.IsLeaf())) {
+      continue;
     }
-    if (not compact_genome.empty()) {
-      return;
+    for (Node current = node; slots.at(current.GetId().value) == NoSlot;
+         current = current.GetFirstParent().GetParent()) {
+      path.push_back(current.GetId());
+      if (current.IsUA()) {
+        break;
+      }
     }
-    Edge edge = for_node.GetFirstParent();
-    self(self, edge.GetParent());
-    const EdgeMutations& mutations = edge.GetEdgeMutations();
-    const CompactGenome& parent = new_cgs.at(edge.GetParentId());
-    compact_genome.AddParentEdge(mutations, parent, dag.GetReferenceSequence());
-  };
-  for (Node node : dag.GetNodes()) {
-    if (recompute_leaves || !node.IsLeaf()) {
-      ComputeCG(ComputeCG, node);
+    for (NodeId id : path | ranges::views::reverse) {
+      Node current = dag.Get(id);
+      size_t parent_slot = NoSlot;
+      size_t depth = 0;
+      if (not current.IsUA()) {
+        parent_slot = slots.at(current.GetFirstParent().GetParentId().value);
+        depth = depths.at(parent_slot) + 1;
+      }
+      slots.at(id.value) = nodes.size();
+      nodes.push_back(id);
+      parent_slots.push_back(parent_slot);
+      depths.push_back(depth);
     }
+    path.clear();
   }
-  for (Node node : dag.GetNodes()) {
-    if (recompute_leaves || !node.IsLeaf()) {
-      node = std::move(new_cgs.at(node.GetId()));
+
+  // Group slots into waves of equal depth. The genomes of a wave depend only
+  // on the previous wave, so each wave is computed in parallel.
+  std::vector<size_t> wave_offsets;
+  for (size_t depth : depths) {
+    if (depth + 2 > wave_offsets.size()) {
+      wave_offsets.resize(depth + 2, 0);
+    }
+    ++wave_offsets.at(depth + 1);
+  }
+  for (size_t i = 1; i < wave_offsets.size(); ++i) {
+    wave_offsets.at(i) += wave_offsets.at(i - 1);
+  }
+  std::vector<size_t> waves(nodes.size());
+  {
+    std::vector<size_t> fill = wave_offsets;
+    for (size_t slot = 0; slot < nodes.size(); ++slot) {
+      waves.at(fill.at(depths.at(slot))++) = slot;
+    }
+  }
+
+  std::vector<CompactGenome> new_cgs(nodes.size());
+  const std::string_view reference_sequence = dag.GetReferenceSequence();
+  for (size_t wave = 0; wave + 1 < wave_offsets.size(); ++wave) {
+    auto wave_slots = ranges::make_subrange(
+        waves.begin() + static_cast<std::ptrdiff_t>(wave_offsets.at(wave)),
+        waves.begin() + static_cast<std::ptrdiff_t>(wave_offsets.at(wave + 1)));
+    auto compute = [&](size_t slot) {
+      size_t parent_slot = parent_slots.at(slot);
+      if (parent_slot == NoSlot) {
+        return;  // UA
+      }
+      auto edge = dag.Get(nodes.at(slot)).GetFirstParent();
+      new_cgs.at(slot).AddParentEdge(edge.GetEdgeMutations(), new_cgs.at(parent_slot),
+                                     reference_sequence);
+    };
+    WaveForEach(wave_slots, compute);
+  }
+
+  if constexpr (Node::template contains_feature<Deduplicate<CompactGenome>>) {
+    // the deduplication storage is concurrent, only the pointer assignment
+    // touches the nodes
+    std::vector<size_t> all_slots(nodes.size());
+    std::iota(all_slots.begin(), all_slots.end(), 0);
+    std::vector<const CompactGenome*> deduplicated(nodes.size());
+    ParallelForEach(all_slots, [&](size_t slot) {
+      deduplicated.at(slot) = dag.template AsFeature<Deduplicate<CompactGenome>>()
+                                  .AddDeduplicated(std::move(new_cgs.at(slot)))
+                                  .first;
+    });
+    for (size_t slot = 0; slot < nodes.size(); ++slot) {
+      Node node = dag.Get(nodes.at(slot));
+      node = deduplicated.at(slot);
+    }
+  } else {
+    for (size_t slot = 0; slot < nodes.size(); ++slot) {
+      Node node = dag.Get(nodes.at(slot));
+      node = std::move(new_cgs.at(slot));
     }
   }
 }
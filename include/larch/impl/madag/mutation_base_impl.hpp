@@ -16,7 +16,7 @@ MutationBase MutationBase::GetFirstCommonBase(const MutationBase& rhs) const {
 }
 
 bool MutationBase::IsCompatible(const MutationBase& rhs) const {
-  return Common(rhs).has_value();
+  return (value & rhs.value) != 0;
 }
 
 std::string MutationBase::ToString(const std::vector<MutationBase>& m_in) {
@@ -27,6 +27,83 @@ std::string MutationBase::ToString(const std::vector<MutationBase>& m_in) {
   return str_out;
 }
 
+std::uint8_t MutationBase::ToNibble() const {
+  static_assert(acgt == (mask('A') | mask('C') | mask('G') | mask('T')));
+  Assert(value == ~zero or (value & ~acgt) == 0);
+  return Nibble();
+}
+
+MutationBase MutationBase::FromNibble(std::uint8_t nibble) {
+  return MutationBase{nibble_values[nibble & 0xF]};
+}
+
+std::uint64_t PackedBases::Load(const std::uint8_t* bytes, size_t size) {
+  // assumes a little endian target, so that nibble i of the array is nibble i
+  // of the word
+  std::uint64_t result = 0;
+  std::memcpy(&result, bytes, size);
+  return result;
+}
+
+std::uint64_t PackedBases::LowBits(size_t bits) {
+  return bits >= 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << bits) - 1;
+}
+
+std::uint64_t PackedBases::SingleBaseMask(std::uint64_t nibbles) {
+  constexpr std::uint64_t ones = 0x1111111111111111;
+  // per-nibble popcount, then test each count for being one
+  std::uint64_t count = nibbles - ((nibbles >> 1) & 0x5555555555555555);
+  count = (count & 0x3333333333333333) + ((count >> 2) & 0x3333333333333333);
+  return ~NonZeroMask(count ^ ones) & (ones << 3);
+}
+
+std::uint64_t PackedBases::NonZeroMask(std::uint64_t nibbles) {
+  // the high bit of each nibble is set iff the nibble is non-zero
+  constexpr std::uint64_t low = 0x7777777777777777;
+  return (((nibbles & low) + low) | nibbles) & ~low;
+}
+
+size_t PackedBases::CountAmbiguous(const std::uint8_t* nibbles, size_t count) {
+  size_t result = 0;
+  for (size_t i = 0; i < count; i += 16) {
+    const size_t word_count = std::min<size_t>(16, count - i);
+    const std::uint64_t word = Load(nibbles + i / 2, (word_count + 1) / 2);
+    const std::uint64_t valid = LowBits(4 * word_count);
+    result += static_cast<size_t>(
+        __builtin_popcountll(~SingleBaseMask(word) & valid & 0x8888888888888888));
+  }
+  return result;
+}
+
+bool PackedBases::AllCompatible(const std::uint8_t* lhs, const std::uint8_t* rhs,
+                                size_t count) {
+  for (size_t i = 0; i < count; i += 16) {
+    const size_t word_count = std::min<size_t>(16, count - i);
+    const size_t bytes = (word_count + 1) / 2;
+    const std::uint64_t valid = LowBits(4 * word_count);
+    const std::uint64_t common = Load(lhs + i / 2, bytes) & Load(rhs + i / 2, bytes);
+    if ((NonZeroMask(common) & valid) != (valid & 0x8888888888888888)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t PackedBases::CountLeafMutations(const std::uint8_t* pairs, size_t count) {
+  size_t result = 0;
+  for (size_t i = 0; i < count; i += 8) {
+    const size_t word_count = std::min<size_t>(8, count - i);
+    const std::uint64_t valid = LowBits(8 * word_count);
+    const std::uint64_t single = SingleBaseMask(Load(pairs + i, word_count));
+    // bit 3 of each byte: the parent is ambiguous, or the child, whose flag
+    // is moved down from bit 7, is not
+    const std::uint64_t counted =
+        (~single | (single >> 4)) & valid & 0x0808080808080808;
+    result += static_cast<size_t>(__builtin_popcountll(counted));
+  }
+  return result;
+}
+
 // inline std::ostream& operator<<(std::ostream& os, const MutationBase& m_in) {
 //   os << m_in.ToChar();
 //   return os;
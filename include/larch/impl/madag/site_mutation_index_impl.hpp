@@ -0,0 +1,122 @@
+template <typename DAG>
+SiteMutationIndex SiteMutationIndex::Build(DAG dag) {
+  SiteMutationIndex result;
+  result.edges_by_site_.resize(dag.GetReferenceSequence().size() + 1);
+
+  // Collect (site, edge) pairs from contiguous ranges of edge ids in
+  // parallel, then append them range by range, so that the edges of every
+  // site end up sorted without a sort.
+  std::vector<EdgeId> edge_ids =
+      dag.GetEdges() | Transform::GetId() | ranges::to_vector;
+  ranges::sort(edge_ids);
+  constexpr size_t ChunkSize = 4096;
+  std::vector<size_t> chunks((edge_ids.size() + ChunkSize - 1) / ChunkSize);
+  std::iota(chunks.begin(), chunks.end(), 0);
+  std::vector<std::vector<std::pair<std::uint32_t, EdgeId>>> found(chunks.size());
+  ParallelForEach(chunks, [&](size_t chunk) {
+    const size_t end = std::min(edge_ids.size(), (chunk + 1) * ChunkSize);
+    auto& chunk_found = found.at(chunk);
+    for (size_t i = chunk * ChunkSize; i < end; ++i) {
+      const EdgeId id = edge_ids[i];
+      for (std::uint32_t site : dag.Get(id).GetEdgeMutations().GetPositions()) {
+        chunk_found.emplace_back(site, id);
+      }
+    }
+  });
+
+  std::vector<size_t> counts(result.edges_by_site_.size(), 0);
+  for (auto& chunk_found : found) {
+    for (auto [site, id] : chunk_found) {
+      Assert(site < counts.size());
+      ++counts[site];
+    }
+  }
+  for (size_t site = 0; site < counts.size(); ++site) {
+    result.edges_by_site_[site].reserve(counts[site]);
+  }
+  for (auto& chunk_found : found) {
+    for (auto [site, id] : chunk_found) {
+      result.edges_by_site_[site].push_back(id);
+    }
+  }
+  return result;
+}
+
+const std::vector<EdgeId>& SiteMutationIndex::GetEdges(MutationPosition pos) const {
+  static const std::vector<EdgeId> empty;
+  if (pos.value >= edges_by_site_.size()) {
+    return empty;
+  }
+  return edges_by_site_[pos.value];
+}
+
+template <typename DAG>
+std::vector<NodeId> SiteMutationIndex::GetNodes(DAG dag, MutationPosition pos) const {
+  return GetEdges(pos) | ranges::views::transform([dag](EdgeId id) {
+           return dag.Get(id).GetChildId();
+         }) |
+         ranges::to_vector;
+}
+
+size_t SiteMutationIndex::GetCount(MutationPosition pos) const {
+  return GetEdges(pos).size();
+}
+
+std::vector<MutationPosition> SiteMutationIndex::GetSites() const {
+  std::vector<MutationPosition> result;
+  for (size_t site = 1; site < edges_by_site_.size(); ++site) {
+    if (not edges_by_site_[site].empty()) {
+      result.push_back({site});
+    }
+  }
+  return result;
+}
+
+void SiteMutationIndex::AddEdge(EdgeId edge, const EdgeMutations& mutations) {
+  for (auto [pos, nucs] : mutations) {
+    Add(edge, pos);
+  }
+}
+
+void SiteMutationIndex::RemoveEdge(EdgeId edge, const EdgeMutations& mutations) {
+  for (auto [pos, nucs] : mutations) {
+    Remove(edge, pos);
+  }
+}
+
+void SiteMutationIndex::UpdateEdge(EdgeId edge, const EdgeMutations& old_mutations,
+                                   const EdgeMutations& new_mutations) {
+  // only touch the sites that differ between the old and new mutations
+  const auto& old_sites = old_mutations.GetPositions();
+  const auto& new_sites = new_mutations.GetPositions();
+  MergeSortedUnique(
+      old_sites.data(), old_sites.size(), new_sites.data(), new_sites.size(),
+      [&](size_t i) { Remove(edge, {old_sites[i]}); },
+      [&](size_t j) { Add(edge, {new_sites[j]}); }, [](size_t, size_t) {});
+}
+
+size_t SiteMutationIndex::HeapMemoryUsage() const {
+  return ::HeapMemoryUsage(edges_by_site_);
+}
+
+void SiteMutationIndex::Add(EdgeId edge, MutationPosition pos) {
+  if (pos.value >= edges_by_site_.size()) {
+    edges_by_site_.resize(pos.value + 1);
+  }
+  auto& edges = edges_by_site_[pos.value];
+  auto it = std::lower_bound(edges.begin(), edges.end(), edge);
+  if (it == edges.end() or *it != edge) {
+    edges.insert(it, edge);
+  }
+}
+
+void SiteMutationIndex::Remove(EdgeId edge, MutationPosition pos) {
+  if (pos.value >= edges_by_site_.size()) {
+    return;
+  }
+  auto& edges = edges_by_site_[pos.value];
+  auto it = std::lower_bound(edges.begin(), edges.end(), edge);
+  if (it != edges.end() and *it == edge) {
+    edges.erase(it);
+  }
+}
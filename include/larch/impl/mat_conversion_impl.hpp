@@ -147,13 +147,22 @@ inline auto mutations_view(MATNodePtr node) {
              });
 }
 
-static inline void fill_static_reference_sequence(std::string_view dag_ref) {
+static inline void fill_static_reference_sequence(const InternedSequence& dag_ref) {
   static std::mutex static_ref_seq_mutex;
+  // non-owning, so that the last filled reference isn't kept alive
+  static InternedSequence::Weak filled_ref;
   std::lock_guard lock{static_ref_seq_mutex};
-  MAT::Mutation::refs.resize(dag_ref.size() + 1);
-  for (size_t ref_idx = 0; ref_idx < dag_ref.size(); ref_idx++) {
-    MAT::Mutation::refs[ref_idx + 1] = EncodeBaseMAT(dag_ref[ref_idx]);
+  const std::string& sequence = dag_ref.get();
+  // refill only when the reference changed, or refs was grown by MAT code
+  if (filled_ref == dag_ref and
+      MAT::Mutation::refs.size() == sequence.size() + 1) {
+    return;
   }
+  MAT::Mutation::refs.resize(sequence.size() + 1);
+  for (size_t ref_idx = 0; ref_idx < sequence.size(); ref_idx++) {
+    MAT::Mutation::refs[ref_idx + 1] = EncodeBaseMAT(sequence[ref_idx]);
+  }
+  filled_ref = InternedSequence::Weak{dag_ref};
 }
 
 }  // namespace
@@ -162,7 +171,7 @@ template <typename CRTP>
 void ExtraFeatureMutableView<MATConversion, CRTP>::BuildMAT(MAT::Tree& tree) const {
   auto& dag = static_cast<const CRTP&>(*this);
   dag.AssertUA();
-  fill_static_reference_sequence(dag.GetReferenceSequence());
+  fill_static_reference_sequence(dag.GetInternedReferenceSequence());
   dag.template GetFeatureExtraStorage<Component::Node, MATConversion>()
       .get()
       .mat_tree_ = std::addressof(tree);
@@ -59,6 +59,8 @@ bool LeafSet::empty() const { return clades_.empty(); }
 
 size_t LeafSet::size() const { return clades_.size(); }
 
+size_t LeafSet::HeapMemoryUsage() const { return ::HeapMemoryUsage(clades_); }
+
 std::vector<UniqueData> LeafSet::ToParentClade(UniqueData sample_id) const {
   std::vector<UniqueData> result = ranges::to_vector(clades_ | ranges::views::join);
   if (result.empty()) {
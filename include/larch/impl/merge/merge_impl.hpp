@@ -17,6 +17,13 @@ void Merge::AddDAGs(const DAGSRange& dags, NodeId below) {
   if (dags.size() == 0) {
     return;
   }
+  for (auto& dag : dags) {
+    // reference sequences are interned, so this is a pointer comparison
+    if (dag.GetInternedReferenceSequence() !=
+        ResultDAG().GetInternedReferenceSequence()) {
+      Fail("Can't merge DAGs with different reference sequences.");
+    }
+  }
 
   const bool was_empty = ResultDAG().empty();
 
@@ -55,7 +62,8 @@ void Merge::AddDAGs(const DAGSRange& dags, NodeId below) {
   });
 #endif
 
-  std::atomic<size_t> node_id{ResultDAG().GetNextAvailableNodeId<MergeDAG>().value};
+  const NodeId first_new_node = ResultDAG().GetNextAvailableNodeId<MergeDAG>();
+  std::atomic<size_t> node_id{first_new_node.value};
   ParallelForEach(idxs,
                   [&](size_t i) { MergeNodes(i, dags, below, dags_labels, node_id); });
 
@@ -107,6 +115,15 @@ void Merge::AddDAGs(const DAGSRange& dags, NodeId below) {
   Assert(result_node_labels_.size() == ResultDAG().GetNodesCount());
   Assert(result_edges_.size() == ResultDAG().GetEdgesCount());
   GetResult().GetRoot().Validate(true, true);
+
+  // only appended, as sorting the whole list on every call would cost more
+  // than the merge of a small fragment
+  for ([[maybe_unused]] auto& [label, id, parent_id, child_id, clade] : added_edges) {
+    updated_nodes_.push_back(parent_id);
+    if (child_id >= first_new_node) {
+      updated_nodes_.push_back(child_id);
+    }
+  }
 }
 
 template <typename DAG>
@@ -149,6 +166,13 @@ const GrowableHashMap<std::string, CompactGenome>& Merge::SampleIdToCGMap() cons
   return sample_id_to_cg_map_;
 }
 
+const std::vector<NodeId>& Merge::GetUpdatedNodes() const { return updated_nodes_; }
+
+void Merge::ClearUpdatedNodes() {
+  std::unique_lock lock{add_dags_mtx_};
+  updated_nodes_.clear();
+}
+
 void Merge::ComputeResultEdgeMutations() {
   result_edges_.ReadAll(
       [](auto result_edges, auto& /*result_nodes*/, auto& sample_id_to_cg_map,
@@ -181,6 +205,17 @@ bool Merge::ContainsLeafset(const LeafSet& leafset) const {
   return all_leaf_sets_.find(leafset) != nullptr;
 }
 
+MemoryUsageReport Merge::MemoryUsage() const {
+  MemoryUsageReport result;
+  result.Add("result_dag", result_dag_storage_.MemoryUsage());
+  result.Add("all_leaf_sets", all_leaf_sets_.HeapMemoryUsage());
+  result.Add("result_nodes", result_nodes_.HeapMemoryUsage());
+  result.Add("result_node_labels", result_node_labels_.HeapMemoryUsage());
+  result.Add("result_edges", result_edges_.HeapMemoryUsage());
+  result.Add("sample_id_to_cg_map", sample_id_to_cg_map_.HeapMemoryUsage());
+  return result;
+}
+
 template <typename DAGSRange, typename NodeLabelsContainer>
 void Merge::MergeCompactGenomes(size_t i, const DAGSRange& dags, NodeId below,
                                 std::vector<NodeLabelsContainer>& dags_labels) {
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <utility>
+
+template <typename DAG>
+std::vector<CladeHash> ComputeTreeCladeHashes(DAG tree) {
+  // Postorder with an explicit stack, as trees can be very deep. The hash of a
+  // node is the sum of the hashes of its children.
+  std::vector<CladeHash> node_hashes(tree.GetNodesCount(), 0);
+  std::vector<CladeHash> result;
+  std::vector<std::pair<NodeId, bool>> stack{{tree.GetRoot().GetId(), false}};
+  while (not stack.empty()) {
+    auto [id, finish] = stack.back();
+    stack.pop_back();
+    auto node = tree.Get(id);
+    if (not finish) {
+      stack.push_back({id, true});
+      for (auto child_edge : node.GetChildren()) {
+        stack.push_back({child_edge.GetChildId(), false});
+      }
+      continue;
+    }
+    CladeHash& hash = node_hashes.at(id.value);
+    if (node.IsLeaf()) {
+      hash = LeafCladeHash(node.GetSampleIdIndex());
+    } else {
+      for (auto child_edge : node.GetChildren()) {
+        hash += node_hashes.at(child_edge.GetChildId().value);
+      }
+    }
+    if (not node.IsUA()) {
+      result.push_back(hash);
+    }
+  }
+  // nodes with a single child have the same clade as the child
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+  return result;
+}
+
+template <typename DAG>
+std::vector<std::vector<size_t>> ComputeRFDistanceMatrix(
+    const std::vector<DAG>& trees) {
+  const size_t trees_count = trees.size();
+  std::vector<size_t> tree_ids(trees_count);
+  std::iota(tree_ids.begin(), tree_ids.end(), 0);
+  std::vector<std::vector<CladeHash>> clades(trees_count);
+  ParallelForEach(tree_ids, [&](size_t tree) {
+    clades.at(tree) = ComputeTreeCladeHashes(trees.at(tree));
+  });
+
+  // The trees containing a clade, as a bitset over tree ids, mapped to the
+  // number of distinct clades contained in exactly those trees.
+  using Membership = std::vector<std::uint64_t>;
+  const size_t words = (trees_count + 63) / 64;
+
+  // Clade hashes are uniform, so splitting them into ranges by their top bits
+  // gives parts of similar size, which are grouped in parallel.
+  constexpr size_t RangeBits = 8;
+  constexpr size_t RangesCount = size_t{1} << RangeBits;
+  auto range_begin = [](size_t range) {
+    return static_cast<CladeHash>(range) << (128 - RangeBits);
+  };
+  std::vector<size_t> ranges_ids(RangesCount);
+  std::iota(ranges_ids.begin(), ranges_ids.end(), 0);
+  std::vector<std::map<Membership, size_t>> range_groups(RangesCount);
+  ParallelForEach(ranges_ids, [&](size_t range) {
+    std::vector<std::pair<CladeHash, size_t>> found;
+    for (size_t tree = 0; tree < trees_count; ++tree) {
+      const auto& tree_clades = clades.at(tree);
+      auto it = std::lower_bound(tree_clades.begin(), tree_clades.end(),
+                                 range_begin(range));
+      auto end = range + 1 < RangesCount
+                     ? std::lower_bound(it, tree_clades.end(), range_begin(range + 1))
+                     : tree_clades.end();
+      for (; it != end; ++it) {
+        found.emplace_back(*it, tree);
+      }
+    }
+    std::sort(found.begin(), found.end());
+    auto& groups = range_groups.at(range);
+    for (size_t i = 0; i < found.size();) {
+      Membership membership(words, 0);
+      size_t j = i;
+      for (; j < found.size() and found[j].first == found[i].first; ++j) {
+        membership[found[j].second / 64] |= std::uint64_t{1} << (found[j].second % 64);
+      }
+      ++groups[std::move(membership)];
+      i = j;
+    }
+  });
+  std::map<Membership, size_t> groups;
+  for (auto& range : range_groups) {
+    for (auto& [membership, count] : range) {
+      groups[membership] += count;
+    }
+  }
+
+  // the trees of every group, and the groups containing every tree
+  std::vector<std::pair<std::vector<size_t>, size_t>> group_trees;
+  std::vector<std::vector<size_t>> tree_groups(trees_count);
+  for (auto& [membership, count] : groups) {
+    std::vector<size_t> members;
+    for (size_t tree = 0; tree < trees_count; ++tree) {
+      if ((membership[tree / 64] >> (tree % 64)) & 1) {
+        members.push_back(tree);
+        tree_groups.at(tree).push_back(group_trees.size());
+      }
+    }
+    group_trees.emplace_back(std::move(members), count);
+  }
+
+  // each task fills one row
+  std::vector<std::vector<size_t>> result(trees_count);
+  ParallelForEach(tree_ids, [&](size_t tree) {
+    std::vector<size_t> shared(trees_count, 0);
+    for (size_t group : tree_groups.at(tree)) {
+      const auto& [members, count] = group_trees.at(group);
+      for (size_t other : members) {
+        shared[other] += count;
+      }
+    }
+    auto& row = result.at(tree);
+    row.resize(trees_count);
+    for (size_t other = 0; other < trees_count; ++other) {
+      row[other] =
+          clades.at(tree).size() + clades.at(other).size() - 2 * shared[other];
+    }
+  });
+  return result;
+}
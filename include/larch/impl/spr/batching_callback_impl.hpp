@@ -216,7 +216,7 @@ auto BatchingCallback<CRTP>::GetMappedStorage() {
 template <typename CRTP>
 void BatchingCallback<CRTP>::CreateMATViewStorage(MAT::Tree& tree,
                                                   std::string_view ref_seq) {
-  SetSample(tree, std::string{ref_seq});
+  SetSample(tree, ref_seq);
   UncondensedMATViewStorage mv_storage;
   mv_storage.View().SetMAT(std::addressof(sample_mat_tree_));
   // mv_storage.View().BuildRootAndLeafs();
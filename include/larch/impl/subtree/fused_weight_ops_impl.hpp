@@ -0,0 +1,82 @@
+#include <numeric>
+#include <utility>
+
+template <typename... Ops>
+template <typename DAG>
+typename FusedWeightOps<Ops...>::Weight FusedWeightOps<Ops...>::ComputeLeaf(
+    DAG dag, NodeId node_id) const {
+  return std::apply(
+      [dag, node_id](const auto&... ops) {
+        return Weight{{ops.ComputeLeaf(dag, node_id), Count{1}}...};
+      },
+      ops_);
+}
+
+template <typename... Ops>
+template <typename DAG>
+typename FusedWeightOps<Ops...>::Weight FusedWeightOps<Ops...>::ComputeEdge(
+    DAG dag, EdgeId edge_id) const {
+  return std::apply(
+      [dag, edge_id](const auto&... ops) {
+        return Weight{{ops.ComputeEdge(dag, edge_id), Count{1}}...};
+      },
+      ops_);
+}
+
+template <typename... Ops>
+std::pair<typename FusedWeightOps<Ops...>::Weight, std::vector<size_t>>
+FusedWeightOps<Ops...>::WithinCladeAccumOptimum(
+    const std::vector<Weight>& inweights) const {
+  auto accum = [this, &inweights]<size_t I>(std::integral_constant<size_t, I>) {
+    auto [weight, optimal] =
+        std::get<I>(ops_).WithinCladeAccumOptimum(Component<I>(inweights));
+    Count count = 0;
+    for (size_t i : optimal) {
+      count += std::get<I>(inweights.at(i)).second;
+    }
+    return std::pair{std::move(weight), std::move(count)};
+  };
+  std::vector<size_t> all(inweights.size());
+  std::iota(all.begin(), all.end(), 0);
+  return {[&accum]<size_t... I>(std::index_sequence<I...>) {
+            return Weight{accum(std::integral_constant<size_t, I>{})...};
+          }(std::index_sequence_for<Ops...>{}),
+          std::move(all)};
+}
+
+template <typename... Ops>
+typename FusedWeightOps<Ops...>::Weight FusedWeightOps<Ops...>::BetweenClades(
+    const std::vector<Weight>& inweights) const {
+  auto combine = [this, &inweights]<size_t I>(std::integral_constant<size_t, I>) {
+    Count count = 1;
+    for (auto& weight : inweights) {
+      count *= std::get<I>(weight).second;
+    }
+    return std::pair{std::get<I>(ops_).BetweenClades(Component<I>(inweights)),
+                     std::move(count)};
+  };
+  return [&combine]<size_t... I>(std::index_sequence<I...>) {
+    return Weight{combine(std::integral_constant<size_t, I>{})...};
+  }(std::index_sequence_for<Ops...>{});
+}
+
+template <typename... Ops>
+typename FusedWeightOps<Ops...>::Weight FusedWeightOps<Ops...>::AboveNode(
+    const Weight& edgeweight, const Weight& childnodeweight) const {
+  return [&]<size_t... I>(std::index_sequence<I...>) {
+    return Weight{{std::get<I>(ops_).AboveNode(std::get<I>(edgeweight).first,
+                                               std::get<I>(childnodeweight).first),
+                   std::get<I>(childnodeweight).second}...};
+  }(std::index_sequence_for<Ops...>{});
+}
+
+template <typename... Ops>
+template <size_t I>
+auto FusedWeightOps<Ops...>::Component(const std::vector<Weight>& weights) {
+  std::vector<std::tuple_element_t<I, std::tuple<typename Ops::Weight...>>> result;
+  result.reserve(weights.size());
+  for (auto& weight : weights) {
+    result.push_back(std::get<I>(weight).first);
+  }
+  return result;
+}
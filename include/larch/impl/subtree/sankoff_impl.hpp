@@ -101,21 +101,9 @@ void SankoffScorer<DAG>::CollectVariableSites() {
   size_t num_edges = dag_.GetEdgesCount();
   size_t num_sites = dp_table_.variable_sites.size();
 
-  dp_table_.dp_costs.resize(num_nodes);
-  for (auto& node_costs : dp_table_.dp_costs) {
-    node_costs.resize(num_sites);
-    for (auto& site_costs : node_costs) {
-      site_costs.fill(kSankoffInfinity);
-    }
-  }
-
-  dp_table_.traceback.resize(num_edges);
-  for (auto& edge_traceback : dp_table_.traceback) {
-    edge_traceback.resize(num_sites);
-    for (auto& site_traceback : edge_traceback) {
-      site_traceback.fill(0);
-    }
-  }
+  dp_table_.dp_costs.assign(num_nodes,
+                            std::vector<double>(4 * num_sites, kSankoffInfinity));
+  dp_table_.traceback.assign(num_edges, std::vector<uint8_t>(4 * num_sites, 0));
 
   // Allocate ancestral bases storage
   ancestral_bases_.resize(num_nodes);
@@ -145,6 +133,17 @@ void SankoffScorer<DAG>::InitializeCostMatrices() {
       dp_table_.cost_matrices[site_idx] = default_matrix;
     }
   }
+
+  dp_table_.cost_planes.resize(16 * num_sites);
+  for (size_t site_idx = 0; site_idx < num_sites; ++site_idx) {
+    const SiteCostMatrix& matrix = dp_table_.cost_matrices[site_idx];
+    for (size_t parent_base = 0; parent_base < 4; ++parent_base) {
+      for (size_t child_base = 0; child_base < 4; ++child_base) {
+        dp_table_.cost_planes[(parent_base * 4 + child_base) * num_sites + site_idx] =
+            matrix[parent_base][child_base];
+      }
+    }
+  }
 }
 
 template <typename DAG>
@@ -165,20 +164,18 @@ template <typename DAG>
 void SankoffScorer<DAG>::ComputeNodeCosts(typename DAG::NodeView node) {
   size_t node_idx = node.GetId().value;
   size_t num_sites = dp_table_.variable_sites.size();
+  std::vector<double>& node_costs = dp_table_.dp_costs[node_idx];
 
   if (node.IsLeaf()) {
     // Leaf node: cost 0 for observed base, infinity for others
+    std::fill(node_costs.begin(), node_costs.end(), kSankoffInfinity);
     for (size_t site_idx = 0; site_idx < num_sites; ++site_idx) {
       MutationPosition pos = dp_table_.variable_sites[site_idx];
       MutationBase observed = GetLeafBase(node, pos);
-      std::vector<size_t> compatible = GetCompatibleIndices(observed);
-
-      // Initialize all to infinity
-      dp_table_.dp_costs[node_idx][site_idx].fill(kSankoffInfinity);
 
       // Set compatible bases to 0
-      for (size_t base_idx : compatible) {
-        dp_table_.dp_costs[node_idx][site_idx][base_idx] = 0.0;
+      for (size_t base_idx : GetCompatibleIndices(observed)) {
+        node_costs[base_idx * num_sites + site_idx] = 0.0;
       }
     }
     return;
@@ -186,9 +183,7 @@ void SankoffScorer<DAG>::ComputeNodeCosts(typename DAG::NodeView node) {
 
   // Internal node: recursively compute children first, then aggregate
   // Initialize costs to 0 (will accumulate from children)
-  for (size_t site_idx = 0; site_idx < num_sites; ++site_idx) {
-    dp_table_.dp_costs[node_idx][site_idx].fill(0.0);
-  }
+  std::fill(node_costs.begin(), node_costs.end(), 0.0);
 
   // Process each child edge
   for (auto clade : node.GetClades()) {
@@ -202,32 +197,11 @@ void SankoffScorer<DAG>::ComputeNodeCosts(typename DAG::NodeView node) {
 
       size_t child_idx = child.GetId().value;
 
-      // For each site, compute contribution from this child
-      for (size_t site_idx = 0; site_idx < num_sites; ++site_idx) {
-        const SiteCostMatrix& cost_matrix = dp_table_.cost_matrices[site_idx];
-        const SiteCosts& child_costs = dp_table_.dp_costs[child_idx][site_idx];
-
-        // For each possible parent base, find optimal child base
-        for (size_t parent_base = 0; parent_base < 4; ++parent_base) {
-          double best_cost = kSankoffInfinity;
-          uint8_t best_child_base = 0;
-
-          for (size_t child_base = 0; child_base < 4; ++child_base) {
-            double cost =
-                cost_matrix[parent_base][child_base] + child_costs[child_base];
-            if (cost < best_cost) {
-              best_cost = cost;
-              best_child_base = static_cast<uint8_t>(child_base);
-            }
-          }
-
-          // Store traceback
-          dp_table_.traceback[edge_idx][site_idx][parent_base] = best_child_base;
-
-          // Add to node cost
-          dp_table_.dp_costs[node_idx][site_idx][parent_base] += best_cost;
-        }
-      }
+      // For each site and possible parent base, find the optimal child base,
+      // store it as traceback and add its cost to the node cost
+      SankoffMinPlus(dp_table_.cost_planes.data(),
+                     dp_table_.dp_costs[child_idx].data(), node_costs.data(),
+                     dp_table_.traceback[edge_idx].data(), num_sites);
     }
   }
 }
@@ -243,7 +217,7 @@ double SankoffScorer<DAG>::ComputeScoreBelow(typename DAG::NodeView node) {
 
   total_score_ = 0.0;
   for (size_t site_idx = 0; site_idx < num_sites; ++site_idx) {
-    const SiteCosts& costs = dp_table_.dp_costs[node_idx][site_idx];
+    const SiteCosts costs = dp_table_.GetSiteCosts(node_idx, site_idx);
     double min_cost = *std::min_element(costs.begin(), costs.end());
     if (min_cost < kSankoffInfinity) {
       total_score_ += min_cost;
@@ -277,7 +251,8 @@ void SankoffScorer<DAG>::TracebackFromNode(typename DAG::NodeView node,
       std::vector<uint8_t> child_bases(num_sites);
       for (size_t site_idx = 0; site_idx < num_sites; ++site_idx) {
         uint8_t parent_base = assigned_bases[site_idx];
-        child_bases[site_idx] = dp_table_.traceback[edge_idx][site_idx][parent_base];
+        child_bases[site_idx] =
+            dp_table_.traceback[edge_idx][parent_base * num_sites + site_idx];
       }
 
       TracebackFromNode(child, child_bases);
@@ -298,7 +273,7 @@ void SankoffScorer<DAG>::ReconstructAncestralSequences(typename DAG::NodeView ro
   // Choose optimal base at root for each site
   std::vector<uint8_t> root_bases(num_sites);
   for (size_t site_idx = 0; site_idx < num_sites; ++site_idx) {
-    const SiteCosts& costs = dp_table_.dp_costs[root_idx][site_idx];
+    const SiteCosts costs = dp_table_.GetSiteCosts(root_idx, site_idx);
     size_t best_base = 0;
     double best_cost = costs[0];
     for (size_t base = 1; base < 4; ++base) {
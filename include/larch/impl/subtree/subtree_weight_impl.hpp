@@ -1,8 +1,14 @@
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <numeric>
 #include <type_traits>
 #include <set>
 
 struct SumRFDistance;
+struct TreeCount;
+struct LogTreeCount;
 
 template <typename WeightOps, typename DAG>
 SubtreeWeight<WeightOps, DAG>::SubtreeWeight(DAG dag,
@@ -10,7 +16,8 @@ SubtreeWeight<WeightOps, DAG>::SubtreeWeight(DAG dag,
     : dag_{dag},
       cached_weights_(dag_.GetNodesCount()),
       cached_subtree_counts_(dag_.GetNodesCount()),
-      cached_min_weight_edges_(dag_.GetNodesCount()) {
+      cached_min_weight_edges_(dag_.GetNodesCount()),
+      node_marks_(dag_.GetNodesCount(), Unmarked) {
   auto rand = random_seed.value_or(random_device_());
   random_generator_ = std::mt19937{rand};
 }
@@ -27,70 +34,178 @@ DAG SubtreeWeight<WeightOps, DAG>::GetDAG() const {
 template <typename WeightOps, typename DAG>
 typename WeightOps::Weight SubtreeWeight<WeightOps, DAG>::ComputeWeightBelow(
     Node node, const WeightOps& weight_ops) {
-  NodeId node_id = node.GetId();
-  auto& cached = cached_weights_.at(node_id.value);
-  if (cached.has_value()) {
-    if constexpr (std::is_copy_constructible_v<typename WeightOps::Weight>) {
-      return cached.value();
-    } else {
-      return cached.value().Copy();
-    }
-  }
-  if (node.IsLeaf()) {
-    cached = weight_ops.ComputeLeaf(dag_, node_id);
-    return cached.value();
-  }
-  std::vector<typename WeightOps::Weight> cladeweights;
-  for (auto clade : node.GetClades()) {
-    cladeweights.push_back(CladeWeight(clade, weight_ops));
+  auto& cached = cached_weights_.at(node.GetId().value);
+  if (not cached.has_value()) {
+    ComputeWeightsBelow(node, weight_ops);
   }
-
-  cached = weight_ops.BetweenClades(cladeweights);
-  return cached.value();
+  return CopyWeight(cached.value());
 }
 
 template <typename WeightOps, typename DAG>
-ArbitraryInt SubtreeWeight<WeightOps, DAG>::MinWeightCount(
+CheckedCount SubtreeWeight<WeightOps, DAG>::MinWeightCount(
     Node node, const WeightOps& weight_ops) {
-  NodeId node_id = node.GetId();
-  auto& cached = cached_subtree_counts_.at(node_id.value);
+  auto& cached = cached_subtree_counts_.at(node.GetId().value);
   if (cached.has_value()) {
     return cached.value();
   }
-  if (node.IsLeaf()) {
-    cached = 1;
-    return cached.value();
-  }
-  ArbitraryInt nodecount = 1;
-  ArbitraryInt cladecount = 0;
   // This populates cached_min_weight_edges_:
-  SubtreeWeight<WeightOps, DAG>::ComputeWeightBelow(node, weight_ops);
-  for (auto& clade : cached_min_weight_edges_.at(node_id.value)) {
-    cladecount = 0;
-    for (auto child_edge_id : clade) {
-      Node child = dag_.Get(child_edge_id).GetChild();
-      cladecount += SubtreeWeight<WeightOps, DAG>::MinWeightCount(child, weight_ops);
+  ComputeWeightBelow(node, weight_ops);
+  // Each task writes only the count of its own node, and reads those of the
+  // children, which are complete.
+  ForEachBelowInWaves(
+      node,
+      [this](NodeId id) { return cached_subtree_counts_.at(id.value).has_value(); },
+      [this](NodeId id) {
+        CheckedCount nodecount = 1;
+        for (auto& clade : cached_min_weight_edges_.at(id.value)) {
+          CheckedCount cladecount = 0;
+          for (auto child_edge_id : clade) {
+            const NodeId child = dag_.Get(child_edge_id).GetChildId();
+            cladecount += cached_subtree_counts_.at(child.value).value();
+          }
+          nodecount *= cladecount;
+        }
+        cached_subtree_counts_.at(id.value) = std::move(nodecount);
+      });
+  return cached.value();
+}
+
+template <typename WeightOps, typename DAG>
+template <typename NodeIds>
+void SubtreeWeight<WeightOps, DAG>::Update(const NodeIds& updated_nodes) {
+  const size_t cached_count = cached_weights_.size();
+  cached_weights_.resize(dag_.GetNodesCount());
+  cached_subtree_counts_.resize(dag_.GetNodesCount());
+  cached_min_weight_edges_.resize(dag_.GetNodesCount());
+  node_marks_.resize(dag_.GetNodesCount(), Unmarked);
+
+  // A cached value implies cached weights below, so the walk up stops at
+  // previously cached nodes without a weight, whose ancestors have none
+  // either. New nodes are always walked through, as their parents may be
+  // cached.
+  std::vector<NodeId> visited;
+  auto visit = [this, &visited](NodeId id) {
+    if (node_marks_.at(id.value) != Unmarked) {
+      return false;
+    }
+    node_marks_.at(id.value) = 0;
+    visited.push_back(id);
+    return true;
+  };
+  std::vector<NodeId> stack;
+  for (NodeId id : updated_nodes) {
+    if (visit(id)) {
+      stack.push_back(id);
     }
-    nodecount *= cladecount;
   }
-  cached = nodecount;
-  return cached.value();
+  while (not stack.empty()) {
+    const NodeId id = stack.back();
+    stack.pop_back();
+    cached_weights_.at(id.value).reset();
+    cached_subtree_counts_.at(id.value).reset();
+    cached_min_weight_edges_.at(id.value).clear();
+    for (auto parent_edge : dag_.Get(id).GetParents()) {
+      const NodeId parent = parent_edge.GetParentId();
+      if (not visit(parent)) {
+        continue;
+      }
+      if (parent.value < cached_count and
+          not cached_weights_.at(parent.value).has_value()) {
+        continue;
+      }
+      stack.push_back(parent);
+    }
+  }
+  for (NodeId id : visited) {
+    node_marks_.at(id.value) = Unmarked;
+  }
 }
 
 template <typename WeightOps, typename DAG>
 typename SubtreeWeight<WeightOps, DAG>::Storage
 SubtreeWeight<WeightOps, DAG>::TrimToMinWeight(const WeightOps& weight_ops) {
-  Storage result = Storage::EmptyDefault();
-  std::unordered_map<NodeId, NodeId> mapped_node;
-  result.View().SetReferenceSequence(dag_.GetReferenceSequence());
+  Node root = dag_.GetRoot();
+  ComputeWeightBelow(root, weight_ops);
 
-  ExtractSubset(
-      dag_.GetRoot(), result.View().AppendNode(), weight_ops,
-      [this](Node node, CladeIdx clade_idx) {
-        return cached_min_weight_edges_.at(node.GetId().value).at(clade_idx.value);
-      },
-      mapped_node, result.View());
-  result.View().BuildConnections();
+  // Mark the nodes reachable from the root through minimum weight edges, one
+  // frontier at a time. Each node is claimed by exactly one parent.
+  std::vector<std::atomic<bool>> kept(dag_.GetNodesCount());
+  kept.at(root.GetId().value) = true;
+  std::vector<NodeId> frontier{root.GetId()};
+  while (not frontier.empty()) {
+    std::vector<std::vector<NodeId>> claimed(frontier.size());
+    std::vector<size_t> idxs(frontier.size());
+    std::iota(idxs.begin(), idxs.end(), 0);
+    auto mark = [&](size_t i) {
+      for (auto& clade_edges : cached_min_weight_edges_.at(frontier[i].value)) {
+        for (EdgeId edge_id : clade_edges) {
+          NodeId child = dag_.Get(edge_id).GetChildId();
+          if (not kept.at(child.value).exchange(true)) {
+            claimed.at(i).push_back(child);
+          }
+        }
+      }
+    };
+    WaveForEach(idxs, mark);
+    frontier.clear();
+    for (auto& nodes : claimed) {
+      frontier.insert(frontier.end(), nodes.begin(), nodes.end());
+    }
+  }
+
+  // Kept nodes keep their relative order, and the edges of each node get
+  // consecutive ids, so the result can be filled in parallel.
+  std::vector<NodeId> kept_nodes;
+  std::vector<size_t> new_node_id(dag_.GetNodesCount(), NoId);
+  std::vector<size_t> first_edge_id;
+  size_t edges_count = 0;
+  for (size_t id = 0; id < kept.size(); ++id) {
+    if (not kept[id]) {
+      continue;
+    }
+    new_node_id[id] = kept_nodes.size();
+    kept_nodes.push_back({id});
+    first_edge_id.push_back(edges_count);
+    for (auto& clade_edges : cached_min_weight_edges_.at(id)) {
+      edges_count += clade_edges.size();
+    }
+  }
+
+  Storage result = Storage::EmptyDefault();
+  auto result_dag = result.View();
+  result_dag.SetReferenceSequence(dag_.GetInternedReferenceSequence());
+  result_dag.InitializeNodes(kept_nodes.size());
+  result_dag.InitializeEdges(edges_count);
+  std::vector<size_t> idxs(kept_nodes.size());
+  std::iota(idxs.begin(), idxs.end(), 0);
+  ParallelForEach(idxs, [&](size_t i) {
+    Node input_node = dag_.Get(kept_nodes[i]);
+    auto result_node = result_dag.Get(NodeId{i});
+    if constexpr (decltype(result_node)::template contains_feature<MappedNodes>) {
+      result_node.SetOriginalId(input_node.GetId());
+    }
+    // compact genomes and edge mutations are carried over, so the result
+    // doesn't need RecomputeCompactGenomes
+    result_node = input_node.GetCompactGenome().Copy(&input_node);
+    auto sid = input_node.GetSampleId();
+    if (sid.has_value()) {
+      result_node = SampleId::Make(sid.value());
+    }
+    EdgeId result_edge_id{first_edge_id[i]};
+    CladeIdx clade_idx{0};
+    for (auto& clade_edges : cached_min_weight_edges_.at(input_node.GetId().value)) {
+      for (EdgeId edge_id : clade_edges) {
+        auto input_edge = dag_.Get(edge_id);
+        auto result_edge = result_dag.Get(result_edge_id);
+        NodeId result_child_id{new_node_id.at(input_edge.GetChildId().value)};
+        result_edge.Set(NodeId{i}, result_child_id, clade_idx);
+        result_edge.SetEdgeMutations(input_edge.GetEdgeMutations().Copy(&input_edge));
+        ++result_edge_id.value;
+      }
+      ++clade_idx.value;
+    }
+  });
+  result_dag.BuildConnections();
   return result;
 }
 
@@ -107,30 +222,21 @@ SubtreeWeight<WeightOps, DAG>::SampleTree(const WeightOps& weight_ops,
       below_node);
 }
 
-struct TreeCount;
 template <typename WeightOps, typename DAG>
 typename SubtreeWeight<WeightOps, DAG>::SampledDAGStorage
 SubtreeWeight<WeightOps, DAG>::UniformSampleTree(const WeightOps& weight_ops,
                                                  std::optional<NodeId> below) {
-  static_assert(std::is_same_v<WeightOps, TreeCount>,
-                "UniformSampleTree needs TreeCount");
+  static_assert(std::is_same_v<WeightOps, TreeCount> or
+                    std::is_same_v<WeightOps, LogTreeCount>,
+                "UniformSampleTree needs TreeCount or LogTreeCount");
   Node below_node = below.has_value() ? dag_.Get(*below) : dag_.GetRoot();
   // Ensure cache is filled
   ComputeWeightBelow(below_node, weight_ops);
   return SampleTreeImpl(
       weight_ops,
-      [this](auto clade) {
-        std::vector<double> probabilities;
-        typename WeightOps::Weight sum{};
-        for (NodeId child : clade | Transform::GetChild()) {
-          sum += cached_weights_.at(child.value).value();
-        }
-        if (sum > 0) {
-          for (NodeId child : clade | Transform::GetChild()) {
-            probabilities.push_back(
-                static_cast<double>(cached_weights_.at(child.value).value() / sum));
-          }
-        }
+      [this, &weight_ops](auto clade) {
+        std::vector<double> probabilities =
+            CladeProbabilities(TreeSampling::Uniform, clade, weight_ops);
         return std::discrete_distribution<size_t>{probabilities.begin(),
                                                   probabilities.end()};
       },
@@ -146,20 +252,9 @@ SubtreeWeight<WeightOps, DAG>::MinWeightSampleTree(const WeightOps& weight_ops,
   ComputeWeightBelow(below_node, weight_ops);
   return SampleTreeImpl(
       weight_ops,
-      [this](auto clade) {
-        Edge first_edge = dag_.Get(clade.at(0));
-        auto cached_clade = cached_min_weight_edges_.at(first_edge.GetParentId().value)
-                                .at(first_edge.GetClade().value);
-        ContiguousSet<EdgeId> min_weight_edges(cached_clade.begin(),
-                                               cached_clade.end());
-        std::vector<double> probabilities;
-        for (EdgeId child_edge : clade) {
-          if (min_weight_edges.Contains(child_edge)) {
-            probabilities.push_back(1);
-          } else {
-            probabilities.push_back(0);
-          }
-        }
+      [this, &weight_ops](auto clade) {
+        std::vector<double> probabilities =
+            CladeProbabilities(TreeSampling::MinWeight, clade, weight_ops);
         return std::discrete_distribution<size_t>{probabilities.begin(),
                                                   probabilities.end()};
       },
@@ -177,57 +272,484 @@ SubtreeWeight<WeightOps, DAG>::MinWeightUniformSampleTree(const WeightOps& weigh
   return SampleTreeImpl(
       weight_ops,
       [this, &weight_ops](auto clade) {
-        Edge first_edge = dag_.Get(clade.at(0));
-        auto& cached_clade = cached_min_weight_edges_.at(first_edge.GetParentId().value)
-                                 .at(first_edge.GetClade().value);
-        ContiguousSet<EdgeId> min_weight_edges(cached_clade.begin(),
-                                               cached_clade.end());
-        std::vector<ArbitraryInt> min_weight_counts;
-        ArbitraryInt sum = 0;
-        for (EdgeId child_edge : clade) {
-          if (min_weight_edges.Contains(child_edge)) {
-            ArbitraryInt child_count =
-                MinWeightCount(dag_.Get(child_edge).GetChild(), weight_ops);
-            sum += child_count;
-            min_weight_counts.push_back(child_count);
-          } else {
-            min_weight_counts.push_back(0);
-          }
-        }
-        std::vector<double> probabilities;
-        for (auto count : min_weight_counts) {
-          probabilities.push_back(static_cast<double>(count / sum));
-        }
+        std::vector<double> probabilities =
+            CladeProbabilities(TreeSampling::MinWeightUniform, clade, weight_ops);
         return std::discrete_distribution<size_t>{probabilities.begin(),
                                                   probabilities.end()};
       },
       below_node);
 }
+
+template <typename WeightOps, typename DAG>
+std::vector<SampledTreeEdges> SubtreeWeight<WeightOps, DAG>::SampleTrees(
+    const WeightOps& weight_ops, TreeSampling sampling, size_t count, uint32_t seed,
+    bool deduplicate, std::optional<NodeId> below) {
+  Node below_node = below.has_value() ? dag_.Get(*below) : dag_.GetRoot();
+  Assert(not below_node.IsLeaf());
+  dag_.AssertUA();
+  ComputeWeightBelow(below_node, weight_ops);
+
+  // Cumulative edge probabilities of the clades reachable from `below_node`,
+  // indexed by NodeId and CladeIdx. This is the only step that may fill the
+  // caches, so it runs before the draws.
+  std::vector<std::vector<std::vector<double>>> cumulative(dag_.GetNodesCount());
+  std::vector<bool> visited(dag_.GetNodesCount(), false);
+  std::vector<NodeId> stack{below_node.GetId()};
+  visited.at(below_node.GetId().value) = true;
+  while (not stack.empty()) {
+    Node node = dag_.Get(stack.back());
+    stack.pop_back();
+    auto& node_cumulative = cumulative.at(node.GetId().value);
+    for (auto clade : node.GetClades()) {
+      Assert(not clade.empty());
+      std::vector<double> probabilities =
+          CladeProbabilities(sampling, clade, weight_ops);
+      if (not(std::accumulate(probabilities.begin(), probabilities.end(), 0.0) > 0)) {
+        // like std::discrete_distribution, always pick the first edge
+        probabilities.assign(1, 1);
+      }
+      size_t edge_idx = 0;
+      for (auto edge : clade) {
+        const NodeId child = edge.GetChildId();
+        if (edge_idx < probabilities.size() and probabilities[edge_idx] > 0 and
+            not visited.at(child.value)) {
+          visited.at(child.value) = true;
+          stack.push_back(child);
+        }
+        ++edge_idx;
+      }
+      std::partial_sum(probabilities.begin(), probabilities.end(),
+                       probabilities.begin());
+      node_cumulative.push_back(std::move(probabilities));
+    }
+  }
+
+  std::vector<SampledTreeEdges> trees(count);
+  std::vector<size_t> draws(count);
+  std::iota(draws.begin(), draws.end(), 0);
+  ParallelForEach(draws, [&](size_t draw) {
+    std::seed_seq draw_seed{seed, static_cast<uint32_t>(draw),
+                            static_cast<uint32_t>(draw >> 32)};
+    std::mt19937 random_generator{draw_seed};
+    std::uniform_real_distribution<double> unit{0, 1};
+    auto& edges = trees.at(draw).edges;
+    std::vector<NodeId> pending{below_node.GetId()};
+    while (not pending.empty()) {
+      Node node = dag_.Get(pending.back());
+      pending.pop_back();
+      size_t clade_idx = 0;
+      for (auto clade : node.GetClades()) {
+        const auto& clade_cumulative =
+            cumulative.at(node.GetId().value).at(clade_idx++);
+        const double target = unit(random_generator) * clade_cumulative.back();
+        const size_t edge_idx = std::min(
+            static_cast<size_t>(std::upper_bound(clade_cumulative.begin(),
+                                                 clade_cumulative.end(), target) -
+                                clade_cumulative.begin()),
+            clade_cumulative.size() - 1);
+        auto edge = clade.at(
+            static_cast<ranges::range_difference_t<decltype(clade)>>(edge_idx));
+        edges.push_back(edge.GetId());
+        pending.push_back(edge.GetChildId());
+      }
+    }
+    std::sort(edges.begin(), edges.end());
+  });
+
+  if (deduplicate) {
+    // group equal trees, keeping the earliest draw of each group with the
+    // group's size as its count
+    std::vector<size_t> order = draws;
+    std::stable_sort(order.begin(), order.end(), [&trees](size_t lhs, size_t rhs) {
+      return trees.at(lhs).edges < trees.at(rhs).edges;
+    });
+    std::vector<bool> keep(count, false);
+    for (size_t i = 0; i < order.size();) {
+      size_t j = i + 1;
+      while (j < order.size() and
+             trees.at(order[j]).edges == trees.at(order[i]).edges) {
+        ++j;
+      }
+      trees.at(order[i]).count = j - i;
+      keep.at(order[i]) = true;
+      i = j;
+    }
+    std::vector<SampledTreeEdges> unique_trees;
+    for (size_t draw = 0; draw < count; ++draw) {
+      if (keep.at(draw)) {
+        unique_trees.push_back(std::move(trees.at(draw)));
+      }
+    }
+    trees = std::move(unique_trees);
+  }
+  return trees;
+}
+
+template <typename WeightOps, typename DAG>
+typename SubtreeWeight<WeightOps, DAG>::SampledDAGStorage
+SubtreeWeight<WeightOps, DAG>::MakeSampledTree(const WeightOps& weight_ops,
+                                               const SampledTreeEdges& tree,
+                                               std::optional<NodeId> below) {
+  Node below_node = below.has_value() ? dag_.Get(*below) : dag_.GetRoot();
+  Assert(not below_node.IsLeaf());
+  dag_.AssertUA();
+  return BuildSampledTree(
+      weight_ops,
+      [&tree](Node node, CladeIdx clade_idx) {
+        for (auto edge : node.GetClade(clade_idx)) {
+          if (std::binary_search(tree.edges.begin(), tree.edges.end(), edge.GetId())) {
+            return edge;
+          }
+        }
+        Fail("Sampled tree has no edge in a clade");
+      },
+      below_node);
+}
+
+template <typename WeightOps, typename DAG>
+std::vector<WeightedTreeEdges<typename WeightOps::Weight>>
+SubtreeWeight<WeightOps, DAG>::LowestWeightTrees(const WeightOps& weight_ops,
+                                                 size_t count,
+                                                 std::optional<NodeId> below) {
+  using Weight = typename WeightOps::Weight;
+  Node below_node = below.has_value() ? dag_.Get(*below) : dag_.GetRoot();
+  if (count == 0) {
+    return {};
+  }
+
+  // A subtree below a clade is an edge of the clade and one of the subtrees
+  // below the edge's child, and a subtree below a node is one subtree below
+  // each of its clades, all referred to by their index in the lists of
+  // lowest weight subtrees.
+  struct CladeSubtree {
+    Weight weight;
+    EdgeId edge;
+    size_t child_subtree;
+  };
+  struct NodeSubtree {
+    Weight weight;
+    std::vector<size_t> clade_subtrees;
+  };
+  struct LowestSubtrees {
+    std::vector<std::vector<CladeSubtree>> clades;
+    std::vector<NodeSubtree> node;
+  };
+  std::vector<LowestSubtrees> lowest(dag_.GetNodesCount());
+
+  auto keep_lowest = [&weight_ops, count](auto& subtrees) {
+    std::stable_sort(subtrees.begin(), subtrees.end(),
+                     [&weight_ops](const auto& lhs, const auto& rhs) {
+                       return IsLower(weight_ops, lhs.weight, rhs.weight);
+                     });
+    if (subtrees.size() > count) {
+      subtrees.erase(subtrees.begin() + static_cast<std::ptrdiff_t>(count),
+                     subtrees.end());
+    }
+  };
+
+  // Each task writes only the lists of its own node, and reads those of the
+  // children, which are complete.
+  ForEachBelowInWaves(
+      below_node, [](NodeId) { return false; },
+      [&](NodeId id) {
+        Node node = dag_.Get(id);
+        auto& node_lowest = lowest.at(id.value);
+        if (node.IsLeaf()) {
+          node_lowest.node.push_back({weight_ops.ComputeLeaf(dag_, id), {}});
+          return;
+        }
+        for (auto clade : node.GetClades()) {
+          auto& clade_subtrees = node_lowest.clades.emplace_back();
+          for (auto edge : clade) {
+            const auto& child_subtrees = lowest.at(edge.GetChildId().value).node;
+            const Weight edge_weight = weight_ops.ComputeEdge(dag_, edge.GetId());
+            for (size_t i = 0; i < child_subtrees.size(); ++i) {
+              clade_subtrees.push_back(
+                  {weight_ops.AboveNode(CopyWeight(edge_weight),
+                                        CopyWeight(child_subtrees[i].weight)),
+                   edge.GetId(), i});
+            }
+          }
+          keep_lowest(clade_subtrees);
+        }
+
+        // combine the clades one at a time, keeping the lowest combinations
+        std::vector<NodeSubtree> combined;
+        for (size_t i = 0; i < node_lowest.clades.front().size(); ++i) {
+          combined.push_back({CopyWeight(node_lowest.clades.front()[i].weight), {i}});
+        }
+        for (size_t clade = 1; clade < node_lowest.clades.size(); ++clade) {
+          const auto& clade_subtrees = node_lowest.clades[clade];
+          std::vector<NodeSubtree> next;
+          next.reserve(combined.size() * clade_subtrees.size());
+          for (const auto& partial : combined) {
+            for (size_t i = 0; i < clade_subtrees.size(); ++i) {
+              std::vector<size_t> indices = partial.clade_subtrees;
+              indices.push_back(i);
+              next.push_back({weight_ops.BetweenClades(
+                                  {CopyWeight(partial.weight),
+                                   CopyWeight(clade_subtrees[i].weight)}),
+                              std::move(indices)});
+            }
+          }
+          keep_lowest(next);
+          combined = std::move(next);
+        }
+        // aggregate all clades at once, as ComputeWeightBelow does
+        for (auto& subtree : combined) {
+          std::vector<Weight> clade_weights;
+          for (size_t clade = 0; clade < subtree.clade_subtrees.size(); ++clade) {
+            clade_weights.push_back(CopyWeight(
+                node_lowest.clades[clade][subtree.clade_subtrees[clade]].weight));
+          }
+          subtree.weight = weight_ops.BetweenClades(clade_weights);
+        }
+        keep_lowest(combined);
+        node_lowest.node = std::move(combined);
+      });
+
+  std::vector<WeightedTreeEdges<Weight>> result;
+  const auto& below_subtrees = lowest.at(below_node.GetId().value).node;
+  for (size_t subtree = 0; subtree < below_subtrees.size(); ++subtree) {
+    auto& tree = result.emplace_back(
+        WeightedTreeEdges<Weight>{CopyWeight(below_subtrees[subtree].weight), {}});
+    std::vector<std::pair<NodeId, size_t>> stack{{below_node.GetId(), subtree}};
+    while (not stack.empty()) {
+      auto [id, node_subtree] = stack.back();
+      stack.pop_back();
+      const auto& node_lowest = lowest.at(id.value);
+      const auto& chosen = node_lowest.node.at(node_subtree).clade_subtrees;
+      for (size_t clade = 0; clade < chosen.size(); ++clade) {
+        const auto& clade_subtree = node_lowest.clades.at(clade).at(chosen[clade]);
+        tree.edges.push_back(clade_subtree.edge);
+        stack.push_back(
+            {dag_.Get(clade_subtree.edge).GetChildId(), clade_subtree.child_subtree});
+      }
+    }
+    std::sort(tree.edges.begin(), tree.edges.end());
+  }
+  return result;
+}
+
+template <typename WeightOps, typename DAG>
+template <typename F>
+size_t SubtreeWeight<WeightOps, DAG>::EnumerateMinWeightTrees(
+    const WeightOps& weight_ops, F&& callback, std::optional<NodeId> below) {
+  Node below_node = below.has_value() ? dag_.Get(*below) : dag_.GetRoot();
+  ComputeWeightBelow(below_node, weight_ops);
+
+  struct Clade {
+    NodeId node;
+    size_t clade_idx;
+  };
+  // A decision is the choice of an edge for one clade. `pending` holds the
+  // clades still to decide: deciding a clade pops it and pushes the clades of
+  // the chosen edge's child, so a decision is undone by truncating `pending`
+  // back to `pending_size` and pushing its clade again.
+  struct Decision {
+    Clade clade;
+    size_t choice;
+    size_t pending_size;
+  };
+  std::vector<Clade> pending;
+  std::vector<Decision> decisions;
+  std::vector<EdgeId> edges;
+
+  auto min_weight_edges = [this](const Clade& clade) -> const std::vector<EdgeId>& {
+    return cached_min_weight_edges_.at(clade.node.value).at(clade.clade_idx);
+  };
+  auto push_clades = [this, &pending](NodeId node) {
+    const size_t clades_count = cached_min_weight_edges_.at(node.value).size();
+    for (size_t clade_idx = clades_count; clade_idx > 0; --clade_idx) {
+      pending.push_back({node, clade_idx - 1});
+    }
+  };
+  auto choose = [&](const Decision& decision) {
+    EdgeId edge = min_weight_edges(decision.clade).at(decision.choice);
+    edges.push_back(edge);
+    push_clades(dag_.Get(edge).GetChildId());
+  };
+
+  push_clades(below_node.GetId());
+  size_t count = 0;
+  while (true) {
+    // take the first edge of every undecided clade
+    while (not pending.empty()) {
+      Clade clade = pending.back();
+      pending.pop_back();
+      Assert(not min_weight_edges(clade).empty());
+      decisions.push_back({clade, 0, pending.size()});
+      choose(decisions.back());
+    }
+    ++count;
+    if (not callback(std::as_const(edges))) {
+      break;
+    }
+    // advance the last decision that has more choices, undoing the ones after it
+    while (not decisions.empty()) {
+      Decision& decision = decisions.back();
+      pending.resize(decision.pending_size);
+      edges.pop_back();
+      if (decision.choice + 1 < min_weight_edges(decision.clade).size()) {
+        ++decision.choice;
+        choose(decision);
+        break;
+      }
+      pending.push_back(decision.clade);
+      decisions.pop_back();
+    }
+    if (decisions.empty()) {
+      break;
+    }
+  }
+  return count;
+}
+
+template <typename WeightOps, typename DAG>
+void SubtreeWeight<WeightOps, DAG>::ComputeWeightsBelow(Node node,
+                                                        const WeightOps& weight_ops) {
+  // Each task writes only the cache entries of its own node, and reads those
+  // of the children, which are complete.
+  ForEachBelowInWaves(
+      node, [this](NodeId id) { return cached_weights_.at(id.value).has_value(); },
+      [this, &weight_ops](NodeId id) {
+        Node current = dag_.Get(id);
+        auto& cached = cached_weights_.at(id.value);
+        if (current.IsLeaf()) {
+          cached = weight_ops.ComputeLeaf(dag_, id);
+          return;
+        }
+        auto& min_weight_edges = cached_min_weight_edges_.at(id.value);
+        min_weight_edges.clear();
+        std::vector<typename WeightOps::Weight> cladeweights;
+        for (auto clade : current.GetClades()) {
+          cladeweights.push_back(
+              CladeWeight(clade, weight_ops, min_weight_edges.emplace_back()));
+        }
+        cached = weight_ops.BetweenClades(cladeweights);
+      });
+}
+
+template <typename WeightOps, typename DAG>
+template <typename IsDone, typename F>
+void SubtreeWeight<WeightOps, DAG>::ForEachBelowInWaves(Node node, IsDone&& is_done,
+                                                        F&& func) {
+  constexpr size_t Visiting = Unmarked - 1;
+
+  // Find the nodes below `node` that aren't done with an explicit stack, so
+  // that deep DAGs don't overflow the call stack. A node is finished after all
+  // its descendants, and its height is one more than the largest height of its
+  // children that aren't done. The heights are kept in node_marks_.
+  node_marks_.resize(dag_.GetNodesCount(), Unmarked);
+  auto& heights = node_marks_;
+  std::vector<NodeId> nodes;
+  std::vector<std::pair<NodeId, bool>> stack{{node.GetId(), false}};
+  while (not stack.empty()) {
+    auto [id, finish] = stack.back();
+    stack.pop_back();
+    Node current = dag_.Get(id);
+    if (finish) {
+      size_t height = 0;
+      for (auto child_edge : current.GetChildren()) {
+        const size_t child_height = heights.at(child_edge.GetChildId().value);
+        if (child_height < Visiting) {
+          height = std::max(height, child_height + 1);
+        }
+      }
+      heights.at(id.value) = height;
+      nodes.push_back(id);
+      continue;
+    }
+    if (heights.at(id.value) != Unmarked) {
+      continue;
+    }
+    heights.at(id.value) = Visiting;
+    stack.push_back({id, true});
+    for (auto child_edge : current.GetChildren()) {
+      const NodeId child = child_edge.GetChildId();
+      if (heights.at(child.value) == Unmarked and not is_done(child)) {
+        stack.push_back({child, false});
+      }
+    }
+  }
+
+  // Group the nodes into waves of equal height. A wave depends only on the
+  // waves below it, so the nodes of a wave are processed in parallel.
+  std::vector<size_t> wave_offsets;
+  for (NodeId id : nodes) {
+    const size_t height = heights.at(id.value);
+    if (height + 2 > wave_offsets.size()) {
+      wave_offsets.resize(height + 2, 0);
+    }
+    ++wave_offsets.at(height + 1);
+  }
+  for (size_t i = 1; i < wave_offsets.size(); ++i) {
+    wave_offsets.at(i) += wave_offsets.at(i - 1);
+  }
+  std::vector<NodeId> waves(nodes.size());
+  {
+    std::vector<size_t> fill = wave_offsets;
+    for (NodeId id : nodes) {
+      waves.at(fill.at(heights.at(id.value))++) = id;
+    }
+  }
+  for (NodeId id : nodes) {
+    heights.at(id.value) = Unmarked;
+  }
+
+  for (size_t wave = 0; wave + 1 < wave_offsets.size(); ++wave) {
+    auto wave_nodes = ranges::make_subrange(
+        waves.begin() + static_cast<std::ptrdiff_t>(wave_offsets.at(wave)),
+        waves.begin() + static_cast<std::ptrdiff_t>(wave_offsets.at(wave + 1)));
+    WaveForEach(wave_nodes, func);
+  }
+}
+
 template <typename WeightOps, typename DAG>
 template <typename CladeRange>
 typename WeightOps::Weight SubtreeWeight<WeightOps, DAG>::CladeWeight(
-    CladeRange&& clade, const WeightOps& weight_ops) {
+    CladeRange&& clade, const WeightOps& weight_ops,
+    std::vector<EdgeId>& optimum_edgeids) {
   Assert(not clade.empty());
   std::vector<typename WeightOps::Weight> edge_weights;
   for (auto edge_id : clade) {
-    edge_weights.push_back(weight_ops.AboveNode(
-        weight_ops.ComputeEdge(dag_, edge_id),
-        ComputeWeightBelow(dag_.Get(edge_id).GetChild(), weight_ops)));
+    const NodeId child = dag_.Get(edge_id).GetChildId();
+    edge_weights.push_back(
+        weight_ops.AboveNode(weight_ops.ComputeEdge(dag_, edge_id),
+                             CopyWeight(cached_weights_.at(child.value).value())));
   }
   auto clade_result = weight_ops.WithinCladeAccumOptimum(edge_weights);
 
-  std::vector<EdgeId> optimum_edgeids;
+  optimum_edgeids.clear();
   optimum_edgeids.reserve(clade_result.second.size());
   for (auto i : clade_result.second) {
     optimum_edgeids.push_back(
         clade.at(static_cast<ranges::range_difference_t<decltype(clade)>>(i)));
   }
-  Edge first_edge = dag_.Get(clade.at(0));
-  GetOrInsert(GetOrInsert(cached_min_weight_edges_, first_edge.GetParentId().value),
-              first_edge.GetClade().value) = optimum_edgeids;
   return clade_result.first;
 }
 
+template <typename WeightOps, typename DAG>
+typename WeightOps::Weight SubtreeWeight<WeightOps, DAG>::CopyWeight(
+    const typename WeightOps::Weight& weight) {
+  if constexpr (std::is_copy_constructible_v<typename WeightOps::Weight>) {
+    return weight;
+  } else {
+    return weight.Copy();
+  }
+}
+
+template <typename WeightOps, typename DAG>
+bool SubtreeWeight<WeightOps, DAG>::IsLower(const WeightOps& weight_ops,
+                                            const typename WeightOps::Weight& lhs,
+                                            const typename WeightOps::Weight& rhs) {
+  if constexpr (requires { weight_ops.GetOps().Compare(lhs, rhs); }) {
+    return weight_ops.GetOps().Compare(lhs, rhs);
+  } else {
+    return lhs < rhs;
+  }
+}
+
 template <typename WeightOps, typename DAG>
 template <typename DistributionMaker>
 typename SubtreeWeight<WeightOps, DAG>::SampledDAGStorage
@@ -236,17 +758,95 @@ SubtreeWeight<WeightOps, DAG>::SampleTreeImpl(const WeightOps& weight_ops,
                                               Node below) {
   Assert(not below.IsLeaf());
   dag_.AssertUA();
-  SampledDAGStorage result = SampledDAGStorage::EmptyDefault();
-  result.View().SetReferenceSequence(dag_.GetReferenceSequence());
-  ExtractTree(
-      below, result.View().AppendNode(), weight_ops,
+  return BuildSampledTree(
+      weight_ops,
       [this, &distribution_maker](Node node, CladeIdx clade_idx) {
         auto clade = node.GetClade(clade_idx);
         Assert(not clade.empty());
         return clade.at(static_cast<ranges::range_difference_t<decltype(clade)>>(
             distribution_maker(clade)(random_generator_)));
       },
-      result.View());
+      below);
+}
+
+template <typename WeightOps, typename DAG>
+template <typename CladeRange>
+std::vector<double> SubtreeWeight<WeightOps, DAG>::CladeProbabilities(
+    TreeSampling sampling, CladeRange&& clade, const WeightOps& weight_ops) {
+  std::vector<double> probabilities;
+  switch (sampling) {
+    case TreeSampling::Any:
+      probabilities.assign(static_cast<size_t>(clade.size()), 1);
+      break;
+    case TreeSampling::Uniform:
+      if constexpr (std::is_same_v<WeightOps, TreeCount>) {
+        typename WeightOps::Weight sum{};
+        for (NodeId child : clade | Transform::GetChild()) {
+          sum += cached_weights_.at(child.value).value();
+        }
+        if (sum > 0) {
+          for (NodeId child : clade | Transform::GetChild()) {
+            probabilities.push_back(
+                cached_weights_.at(child.value).value().Fraction(sum));
+          }
+        }
+      } else if constexpr (std::is_same_v<WeightOps, LogTreeCount>) {
+        // counts relative to the largest one, which is exp(0)
+        double max_weight = -std::numeric_limits<double>::infinity();
+        for (NodeId child : clade | Transform::GetChild()) {
+          max_weight = std::max(max_weight, cached_weights_.at(child.value).value());
+        }
+        for (NodeId child : clade | Transform::GetChild()) {
+          probabilities.push_back(
+              std::exp(cached_weights_.at(child.value).value() - max_weight));
+        }
+      } else {
+        Fail("Uniform tree sampling needs TreeCount or LogTreeCount");
+      }
+      break;
+    case TreeSampling::MinWeight:
+    case TreeSampling::MinWeightUniform: {
+      Edge first_edge = dag_.Get(clade.at(0));
+      auto& cached_clade = cached_min_weight_edges_.at(first_edge.GetParentId().value)
+                               .at(first_edge.GetClade().value);
+      ContiguousSet<EdgeId> min_weight_edges(cached_clade.begin(), cached_clade.end());
+      if (sampling == TreeSampling::MinWeight) {
+        for (EdgeId child_edge : clade) {
+          probabilities.push_back(min_weight_edges.Contains(child_edge) ? 1 : 0);
+        }
+        break;
+      }
+      std::vector<CheckedCount> min_weight_counts;
+      CheckedCount sum = 0;
+      for (EdgeId child_edge : clade) {
+        if (min_weight_edges.Contains(child_edge)) {
+          CheckedCount child_count =
+              MinWeightCount(dag_.Get(child_edge).GetChild(), weight_ops);
+          sum += child_count;
+          min_weight_counts.push_back(child_count);
+        } else {
+          min_weight_counts.push_back(0);
+        }
+      }
+      for (auto count : min_weight_counts) {
+        probabilities.push_back(count.Fraction(sum));
+      }
+      break;
+    }
+  }
+  return probabilities;
+}
+
+template <typename WeightOps, typename DAG>
+template <typename EdgeSelector>
+typename SubtreeWeight<WeightOps, DAG>::SampledDAGStorage
+SubtreeWeight<WeightOps, DAG>::BuildSampledTree(const WeightOps& weight_ops,
+                                                const EdgeSelector& edge_selector,
+                                                Node below) {
+  SampledDAGStorage result = SampledDAGStorage::EmptyDefault();
+  result.View().SetReferenceSequence(dag_.GetInternedReferenceSequence());
+  ExtractTree(below, result.View().AppendNode(), weight_ops, edge_selector,
+              result.View());
 
   result.View().BuildConnections();
 
@@ -303,52 +903,3 @@ void SubtreeWeight<WeightOps, DAG>::ExtractTree(NodeType input_node,
                 result);
   }
 }
-
-template <typename WeightOps, typename DAG>
-template <typename NodeType, typename EdgesSelector, typename MutableDAGType>
-void SubtreeWeight<WeightOps, DAG>::ExtractSubset(
-    NodeType input_node, NodeId result_node_id, const WeightOps& weight_ops,
-    const EdgesSelector& edge_selector, std::unordered_map<NodeId, NodeId>& mapped_id,
-    MutableDAGType result) {
-  ComputeWeightBelow(input_node, weight_ops);
-  auto result_node = result.Get(result_node_id);
-  if constexpr (decltype(result_node)::template contains_feature<MappedNodes>) {
-    result_node.SetOriginalId(input_node.GetId());
-  }
-  result_node = input_node.GetCompactGenome().Copy(&input_node);
-  auto sid = input_node.GetSampleId();
-  if (sid.has_value()) {
-    result_node = SampleId::Make(sid.value());
-  }
-
-  mapped_id.insert({input_node.GetId(), result_node});
-
-  CladeIdx clade_idx{0};
-  for (auto clade : input_node.GetClades()) {
-    Assert(not clade.empty());
-
-    std::ignore = clade;
-    auto input_edges = edge_selector(input_node, clade_idx);
-
-    for (auto edge_id : input_edges) {
-      auto input_edge = input_node.GetDAG().Get(edge_id);
-      auto input_node_child = input_edge.GetChild();
-
-      if (mapped_id.find(input_node_child.GetId()) != mapped_id.end()) {
-        NodeId result_child_id = mapped_id[input_node_child.GetId()];
-        auto result_edge =
-            result.AppendEdge(result_node_id, result_child_id, clade_idx);
-        result_edge.SetEdgeMutations(input_edge.GetEdgeMutations().Copy(&input_edge));
-      } else {
-        NodeId result_child_id = result.AppendNode();
-        auto result_edge =
-            result.AppendEdge(result_node_id, result_child_id, clade_idx);
-        result_edge.SetEdgeMutations(input_edge.GetEdgeMutations().Copy(&input_edge));
-        ExtractSubset(input_node_child, result_child_id, weight_ops, edge_selector,
-                      mapped_id, result);
-        mapped_id.insert({input_node_child.GetId(), result_child_id});
-      }
-    }
-    ++clade_idx.value;
-  }
-}
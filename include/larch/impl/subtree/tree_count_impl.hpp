@@ -1,4 +1,7 @@
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
 
 template <typename DAG>
 TreeCount::Weight TreeCount::ComputeLeaf(DAG, NodeId) {
@@ -30,3 +33,40 @@ TreeCount::Weight TreeCount::AboveNode(const TreeCount::Weight&,
                                        TreeCount::Weight childnodeweight) {
   return childnodeweight;
 }
+
+template <typename DAG>
+LogTreeCount::Weight LogTreeCount::ComputeLeaf(DAG, NodeId) {
+  return 0;
+}
+
+template <typename DAG>
+LogTreeCount::Weight LogTreeCount::ComputeEdge(DAG, EdgeId) {
+  return 0;
+}
+
+std::pair<LogTreeCount::Weight, std::vector<size_t>>
+LogTreeCount::WithinCladeAccumOptimum(
+    const std::vector<LogTreeCount::Weight>& inweights) {
+  std::vector<size_t> indices(inweights.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  if (inweights.empty()) {
+    return {-std::numeric_limits<double>::infinity(), indices};
+  }
+  // log-sum-exp, relative to the largest count so that exp doesn't overflow
+  const double max_weight = *std::max_element(inweights.begin(), inweights.end());
+  double sum = 0;
+  for (double weight : inweights) {
+    sum += std::exp(weight - max_weight);
+  }
+  return {max_weight + std::log(sum), indices};
+}
+
+LogTreeCount::Weight LogTreeCount::BetweenClades(
+    const std::vector<LogTreeCount::Weight>& inweights) {
+  return std::accumulate(inweights.begin(), inweights.end(), 0.0);
+}
+
+LogTreeCount::Weight LogTreeCount::AboveNode(LogTreeCount::Weight,
+                                             LogTreeCount::Weight childnodeweight) {
+  return childnodeweight;
+}
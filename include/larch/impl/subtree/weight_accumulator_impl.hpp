@@ -1,21 +1,25 @@
 #include <algorithm>
+#include <iterator>
 
 template <typename WeightOps>
-WeightAccumulator<WeightOps>::WeightAccumulator(const WeightOps& ops)
-    : weight_ops_{ops} {}
+WeightAccumulator<WeightOps>::WeightAccumulator(const WeightOps& ops,
+                                                std::optional<size_t> max_weights)
+    : weight_ops_{ops}, max_weights_{max_weights} {}
 
 template <typename WeightOps>
 template <typename DAG>
 typename WeightAccumulator<WeightOps>::Weight WeightAccumulator<WeightOps>::ComputeLeaf(
     DAG dag, NodeId node_id) const {
-  return WeightCounter<WeightOps>({weight_ops_.ComputeLeaf(dag, node_id)}, weight_ops_);
+  return WeightCounter<WeightOps>({weight_ops_.ComputeLeaf(dag, node_id)}, weight_ops_,
+                                  max_weights_);
 }
 
 template <typename WeightOps>
 template <typename DAG>
 typename WeightAccumulator<WeightOps>::Weight WeightAccumulator<WeightOps>::ComputeEdge(
     DAG dag, EdgeId edge_id) const {
-  return WeightCounter<WeightOps>({weight_ops_.ComputeEdge(dag, edge_id)}, weight_ops_);
+  return WeightCounter<WeightOps>({weight_ops_.ComputeEdge(dag, edge_id)}, weight_ops_,
+                                  max_weights_);
 }
 
 template <typename WeightOps>
@@ -24,7 +28,8 @@ WeightAccumulator<WeightOps>::WithinCladeAccumOptimum(
     const std::vector<typename WeightAccumulator<WeightOps>::Weight>& inweights) const {
   std::vector<size_t> optimal_indices;
   std::iota(optimal_indices.begin(), optimal_indices.end(), 0);
-  return {std::accumulate(inweights.begin(), inweights.end(), Weight{weight_ops_},
+  return {std::accumulate(inweights.begin(), inweights.end(),
+                          Weight{weight_ops_, max_weights_},
                           [](auto&& lhs, const auto& rhs) { return lhs + rhs; }),
           optimal_indices};
 }
@@ -48,35 +53,68 @@ typename WeightAccumulator<WeightOps>::Weight WeightAccumulator<WeightOps>::Abov
   // because edgeweight should have come from ComputeEdge:
   Assert(edgeweight.GetWeights().size() == 1);
   auto edgepair = edgeweight.GetWeights().begin();
-  ContiguousMap<typename WeightOps::Weight, Count> result;
+  std::vector<std::pair<typename WeightOps::Weight, Count>> result;
+  result.reserve(childnodeweight.GetWeights().size());
   for (const auto& childitem : childnodeweight.GetWeights()) {
-    result.insert({weight_ops_.AboveNode(edgepair->first, childitem.first), 0});
-    result.at(weight_ops_.AboveNode(edgepair->first, childitem.first)) +=
-        childitem.second;
+    result.emplace_back(weight_ops_.AboveNode(edgepair->first, childitem.first),
+                        childitem.second);
   }
-  return WeightCounter<WeightOps>(std::move(result), weight_ops_);
+  return WeightCounter<WeightOps>::FromUnsorted(std::move(result), weight_ops_,
+                                                childnodeweight.GetMaxWeights());
 }
 
 template <typename WeightOps>
-WeightCounter<WeightOps>::WeightCounter(const WeightOps& weight_ops)
-    : weight_ops_{weight_ops} {}
+WeightCounter<WeightOps>::WeightCounter(const WeightOps& weight_ops,
+                                        std::optional<size_t> max_weights)
+    : weight_ops_{weight_ops}, max_weights_{max_weights} {}
 
 template <typename WeightOps>
 WeightCounter<WeightOps>::WeightCounter(
     const std::vector<typename WeightOps::Weight>& inweights,
-    const WeightOps& weight_ops)
-    : weight_ops_{weight_ops} {
+    const WeightOps& weight_ops, std::optional<size_t> max_weights)
+    : weight_ops_{weight_ops}, max_weights_{max_weights} {
+  std::vector<std::pair<typename WeightOps::Weight, Count>> weights;
+  weights.reserve(inweights.size());
   for (const auto& weight : inweights) {
-    weights_.insert({weight, 0});
-    weights_.at(weight)++;
+    weights.emplace_back(weight, 1);
   }
+  weights_ = FromUnsorted(std::move(weights), weight_ops, max_weights).weights_;
 }
 
 template <typename WeightOps>
 WeightCounter<WeightOps>::WeightCounter(
     ContiguousMap<typename WeightOps::Weight, Count>&& inweights,
-    const WeightOps& weight_ops)
-    : weights_{std::forward<decltype(inweights)>(inweights)}, weight_ops_{weight_ops} {}
+    const WeightOps& weight_ops, std::optional<size_t> max_weights)
+    : weights_{std::forward<decltype(inweights)>(inweights)},
+      weight_ops_{weight_ops},
+      max_weights_{max_weights} {
+  if (max_weights_.has_value()) {
+    while (weights_.size() > *max_weights_) {
+      weights_.erase(std::prev(weights_.end()));
+    }
+  }
+}
+
+template <typename WeightOps>
+WeightCounter<WeightOps> WeightCounter<WeightOps>::FromUnsorted(
+    std::vector<std::pair<typename WeightOps::Weight, Count>>&& weights,
+    const WeightOps& weight_ops, std::optional<size_t> max_weights) {
+  std::stable_sort(
+      weights.begin(), weights.end(),
+      [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+  const size_t limit = max_weights.value_or(std::numeric_limits<size_t>::max());
+  ContiguousMap<typename WeightOps::Weight, Count> result;
+  for (size_t i = 0; i < weights.size() and result.size() < limit;) {
+    size_t j = i + 1;
+    while (j < weights.size() and not(weights[i].first < weights[j].first)) {
+      weights[i].second += weights[j].second;
+      ++j;
+    }
+    result.push_back(std::move(weights[i]));
+    i = j;
+  }
+  return WeightCounter<WeightOps>(std::move(result), weight_ops, max_weights);
+}
 
 template <typename WeightOps>
 const ContiguousMap<typename WeightOps::Weight, Count>&
@@ -89,36 +127,109 @@ const WeightOps& WeightCounter<WeightOps>::GetWeightOps() const {
   return weight_ops_;
 }
 
+template <typename WeightOps>
+std::optional<size_t> WeightCounter<WeightOps>::GetMaxWeights() const {
+  return max_weights_;
+}
+
+template <typename WeightOps>
+std::optional<size_t> WeightCounter<WeightOps>::CombinedMaxWeights(
+    const WeightCounter<WeightOps>& rhs) const {
+  if (max_weights_.has_value() and rhs.max_weights_.has_value()) {
+    return std::min(*max_weights_, *rhs.max_weights_);
+  }
+  return max_weights_.has_value() ? max_weights_ : rhs.max_weights_;
+}
+
 template <typename WeightOps>
 WeightCounter<WeightOps> WeightCounter<WeightOps>::operator+(
     const WeightCounter<WeightOps>& rhs) const {
-  ContiguousMap<typename WeightOps::Weight, Count> result = weights_.Copy();
-  for (const auto& map_pair : rhs.GetWeights()) {
-    result.insert({map_pair.first, 0});
-    result.at(map_pair.first) += map_pair.second;
+  const std::optional<size_t> max_weights = CombinedMaxWeights(rhs);
+  const size_t limit = max_weights.value_or(std::numeric_limits<size_t>::max());
+  // merge the two sorted maps
+  ContiguousMap<typename WeightOps::Weight, Count> result;
+  result.reserve(std::min(weights_.size() + rhs.weights_.size(), limit));
+  auto lhs_it = weights_.begin();
+  auto rhs_it = rhs.weights_.begin();
+  while ((lhs_it != weights_.end() or rhs_it != rhs.weights_.end()) and
+         result.size() < limit) {
+    if (rhs_it == rhs.weights_.end() or
+        (lhs_it != weights_.end() and lhs_it->first < rhs_it->first)) {
+      result.push_back({lhs_it->first, lhs_it->second});
+      ++lhs_it;
+    } else if (lhs_it == weights_.end() or rhs_it->first < lhs_it->first) {
+      result.push_back({rhs_it->first, rhs_it->second});
+      ++rhs_it;
+    } else {
+      result.push_back({lhs_it->first, lhs_it->second + rhs_it->second});
+      ++lhs_it;
+      ++rhs_it;
+    }
   }
-  return WeightCounter<WeightOps>(std::move(result), weight_ops_);
+  return WeightCounter<WeightOps>(std::move(result), weight_ops_, max_weights);
 }
 
 template <typename WeightOps>
 WeightCounter<WeightOps> WeightCounter<WeightOps>::operator*(
     const WeightCounter<WeightOps>& rhs) const {
-  ContiguousMap<typename WeightOps::Weight, Count> result;
+  using Weight = typename WeightOps::Weight;
+  const std::optional<size_t> max_weights = CombinedMaxWeights(rhs);
+  if (weights_.empty() or rhs.weights_.empty()) {
+    return WeightCounter<WeightOps>(weight_ops_, max_weights);
+  }
+  if constexpr (HasAdditiveWeights<WeightOps>) {
+    // The k lowest sums only involve the k lowest weights of each side, and
+    // when the sums span a small range they are accumulated in a dense array
+    // indexed by their offset from the lowest sum.
+    const size_t limit = max_weights.value_or(std::numeric_limits<size_t>::max());
+    const size_t lhs_count = std::min(weights_.size(), limit);
+    const size_t rhs_count = std::min(rhs.weights_.size(), limit);
+    const auto lhs_begin = weights_.begin();
+    const auto rhs_begin = rhs.weights_.begin();
+    const Weight lhs_min = lhs_begin->first;
+    const Weight rhs_min = rhs_begin->first;
+    const size_t span =
+        static_cast<size_t>(std::prev(lhs_begin + lhs_count)->first - lhs_min) +
+        static_cast<size_t>(std::prev(rhs_begin + rhs_count)->first - rhs_min) + 1;
+    if (span <= 2 * lhs_count * rhs_count + 1024) {
+      std::vector<Count> counts(span);
+      std::vector<bool> present(span, false);
+      for (auto lhs_it = lhs_begin; lhs_it != lhs_begin + lhs_count; ++lhs_it) {
+        const auto lhs_offset = static_cast<size_t>(lhs_it->first - lhs_min);
+        for (auto rhs_it = rhs_begin; rhs_it != rhs_begin + rhs_count; ++rhs_it) {
+          const size_t offset =
+              lhs_offset + static_cast<size_t>(rhs_it->first - rhs_min);
+          counts[offset] += lhs_it->second * rhs_it->second;
+          present[offset] = true;
+        }
+      }
+      ContiguousMap<Weight, Count> result;
+      for (size_t offset = 0; offset < span and result.size() < limit; ++offset) {
+        if (present[offset]) {
+          result.push_back({static_cast<Weight>(lhs_min + rhs_min + offset),
+                            std::move(counts[offset])});
+        }
+      }
+      return WeightCounter<WeightOps>(std::move(result), weight_ops_, max_weights);
+    }
+  }
+  std::vector<std::pair<Weight, Count>> products;
+  products.reserve(weights_.size() * rhs.weights_.size());
   for (const auto& lpair : weights_) {
     for (const auto& rpair : rhs.GetWeights()) {
-      auto value = weight_ops_.BetweenClades({lpair.first, rpair.first});
-      result.insert({value, 0});
-      result.at(value) += lpair.second * rpair.second;
+      products.emplace_back(weight_ops_.BetweenClades({lpair.first, rpair.first}),
+                            lpair.second * rpair.second);
     }
   }
-  return WeightCounter<WeightOps>(std::move(result), weight_ops_);
+  return FromUnsorted(std::move(products), weight_ops_, max_weights);
 }
 
 template <typename WeightOps>
 WeightCounter<WeightOps>& WeightCounter<WeightOps>::operator=(
     const WeightCounter<WeightOps>& rhs) {
-  weights_ = rhs.weights_;
+  weights_ = rhs.weights_.Copy();
   weight_ops_ = rhs.weight_ops_;
+  max_weights_ = rhs.max_weights_;
   return *this;
 }
 
@@ -127,6 +238,7 @@ WeightCounter<WeightOps>& WeightCounter<WeightOps>::operator=(
     WeightCounter<WeightOps>&& rhs) noexcept {
   weights_ = std::move(rhs.weights_);
   weight_ops_ = std::move(rhs.weight_ops_);
+  max_weights_ = rhs.max_weights_;
   return *this;
 }
 
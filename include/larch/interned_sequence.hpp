@@ -0,0 +1,144 @@
+/**
+ * InternedSequence is a ref-counted, immutable string shared by every holder
+ * of equal contents. Interning a string equal to a live interned sequence
+ * returns the existing instance, so equality of interned sequences is pointer
+ * equality.
+ *
+ * Interning a view into a live interned sequence, e.g. the result of
+ * GetReferenceSequence() of another DAG, is a pointer lookup and neither
+ * hashes nor copies the contents.
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "larch/memory_usage.hpp"
+
+class InternedSequence {
+ public:
+  InternedSequence() = default;
+
+  static inline InternedSequence Intern(std::string_view sequence);
+
+  /**
+   * The interned contents, or an empty string if nothing was interned.
+   */
+  const std::string& get() const { return data_ ? *data_ : Empty(); }
+
+  bool empty() const { return get().empty(); }
+
+  bool operator==(const InternedSequence& other) const {
+    return data_ == other.data_ or (empty() and other.empty());
+  }
+  bool operator!=(const InternedSequence& other) const { return not(*this == other); }
+
+  /**
+   * A non-owning handle, which doesn't keep the contents alive. It compares
+   * equal only to holders of the same live contents.
+   */
+  class Weak {
+   public:
+    Weak() = default;
+    explicit Weak(const InternedSequence& sequence) : data_{sequence.data_} {}
+
+    bool operator==(const InternedSequence& other) const {
+      auto data = data_.lock();
+      return data != nullptr and data == other.data_;
+    }
+
+   private:
+    std::weak_ptr<const std::string> data_;
+  };
+
+  /**
+   * Number of holders sharing these contents.
+   */
+  long use_count() const { return data_.use_count(); }
+
+  /**
+   * Bytes of the shared contents. Every holder reports the full size.
+   */
+  size_t HeapMemoryUsage() const {
+    return data_ ? sizeof(std::string) + ::HeapMemoryUsage(*data_) : 0;
+  }
+
+ private:
+  struct Pool {
+    std::mutex mutex;
+    std::unordered_map<std::string_view, std::weak_ptr<const std::string>> by_contents;
+    std::unordered_map<const char*, std::weak_ptr<const std::string>> by_address;
+  };
+
+  explicit InternedSequence(std::shared_ptr<const std::string>&& data)
+      : data_{std::move(data)} {}
+
+  static const std::string& Empty() {
+    static const std::string empty;
+    return empty;
+  }
+
+  static Pool& GetPool() {
+    // never destroyed, so that sequences outliving static destruction can
+    // still release themselves
+    static Pool* pool = new Pool;
+    return *pool;
+  }
+
+  static inline void Release(const std::string* sequence);
+
+  std::shared_ptr<const std::string> data_;
+};
+
+InternedSequence InternedSequence::Intern(std::string_view sequence) {
+  if (sequence.empty()) {
+    return {};
+  }
+  Pool& pool = GetPool();
+  // Declared before the lock, so that a found sequence that isn't returned is
+  // released after unlocking: if it was the last owner, its deleter takes the
+  // lock too.
+  std::shared_ptr<const std::string> by_address;
+  std::shared_ptr<const std::string> by_contents;
+  std::unique_lock lock{pool.mutex};
+  if (auto it = pool.by_address.find(sequence.data()); it != pool.by_address.end()) {
+    by_address = it->second.lock();
+    if (by_address and by_address->size() == sequence.size()) {
+      return InternedSequence{std::move(by_address)};
+    }
+  }
+  if (auto it = pool.by_contents.find(sequence); it != pool.by_contents.end()) {
+    by_contents = it->second.lock();
+    if (by_contents) {
+      return InternedSequence{std::move(by_contents)};
+    }
+    // expired, but not yet released: drop the entry, whose key is about to
+    // dangle
+    pool.by_address.erase(it->first.data());
+    pool.by_contents.erase(it);
+  }
+  std::shared_ptr<const std::string> data{new std::string{sequence}, &Release};
+  pool.by_contents.insert({std::string_view{*data}, data});
+  pool.by_address.insert({data->data(), data});
+  return InternedSequence{std::move(data)};
+}
+
+void InternedSequence::Release(const std::string* sequence) {
+  Pool& pool = GetPool();
+  {
+    std::unique_lock lock{pool.mutex};
+    if (auto it = pool.by_address.find(sequence->data());
+        it != pool.by_address.end() and it->second.expired()) {
+      pool.by_address.erase(it);
+    }
+    if (auto it = pool.by_contents.find(*sequence);
+        it != pool.by_contents.end() and it->first.data() == sequence->data()) {
+      pool.by_contents.erase(it);
+    }
+  }
+  delete sequence;
+}
@@ -1,9 +1,10 @@
 /**
  * A CompactGenome stores a sequence as a diff relative to a reference
- * sequence. This is implemented as a sorted vector of position, character
+ * sequence. This is implemented as a sorted map of position, character
  * pairs. The position is a 1-based index on the reference sequence at which
  * the CompactGenome differs from that reference, and the character describes
- * that differing state.
+ * that differing state. Positions are stored as 32-bit integers and bases as
+ * 4-bit masks (see PackedMap).
  */
 #pragma once
 
@@ -17,9 +18,11 @@
 #include "larch/madag/edge_mutations.hpp"
 #include "larch/contiguous_map.hpp"
 #include "larch/contiguous_set.hpp"
+#include "larch/packed_map.hpp"
+#include "larch/sorted_set_kernels.hpp"
 
 class CompactGenome {
-  ContiguousMap<MutationPosition, MutationBase> mutations_ = {};
+  PackedMap<MutationPosition, MutationBase> mutations_ = {};
   size_t hash_ = {};
 
  public:
@@ -51,6 +54,8 @@ class CompactGenome {
 
   inline bool empty() const;
 
+  [[nodiscard]] inline size_t HeapMemoryUsage() const;
+
   template <typename CRTP>
   [[nodiscard]] inline CompactGenome Copy(const CRTP*) const;
 
@@ -73,8 +78,11 @@ class CompactGenome {
       const CompactGenome& child);
 
  private:
+  inline CompactGenome(PackedMap<MutationPosition, MutationBase>&& mutations,
+                       size_t hash);
+  inline static size_t MutationHash(MutationPosition pos, MutationBase base);
   inline static size_t ComputeHash(
-      const ContiguousMap<MutationPosition, MutationBase>& mutations);
+      const PackedMap<MutationPosition, MutationBase>& mutations);
 };
 
 template <>
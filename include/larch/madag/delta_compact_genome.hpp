@@ -0,0 +1,138 @@
+/**
+ * DeltaCompactGenome is an optional persistent representation of a node's
+ * sequence. Instead of storing all differences from the reference sequence,
+ * it stores a reference to its parent's genome plus the differences introduced
+ * by the parent edge. Genomes of siblings and descendants share their
+ * ancestors' storage, so the memory for a whole DAG is roughly proportional to
+ * the number of edge mutations rather than nodes times mutations from the
+ * reference.
+ *
+ * To bound the cost of lookups, every `checkpoint_interval` generations the
+ * chain is cut and a full copy of the differences from the reference is
+ * stored instead.
+ *
+ * Iteration and lookups are read-only and transparent: begin()/end() yield
+ * the same (position, base) pairs, in the same order, as iterating the
+ * equivalent CompactGenome.
+ */
+
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "larch/madag/compact_genome.hpp"
+#include "larch/packed_map.hpp"
+
+class DeltaCompactGenome {
+  struct Link;
+
+ public:
+  static constexpr size_t DefaultCheckpointInterval = 32;
+
+  class const_iterator {
+   public:
+    using iterator_concept = std::forward_iterator_tag;
+    using iterator_category = std::input_iterator_tag;
+    using value_type = std::pair<MutationPosition, MutationBase>;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type;
+    using pointer = void;
+
+    const_iterator() = default;
+
+    value_type operator*() const { return current_; }
+
+    inline const_iterator& operator++();
+    const_iterator operator++(int) {
+      auto result = *this;
+      ++*this;
+      return result;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return done_ == other.done_ and (done_ or current_.first == other.current_.first);
+    }
+    bool operator!=(const const_iterator& other) const { return not(*this == other); }
+
+   private:
+    friend class DeltaCompactGenome;
+    inline explicit const_iterator(const Link* link);
+
+    struct Level {
+      const PackedMap<MutationPosition, MutationBase>* delta;
+      size_t index;
+    };
+    // Shallowest first, exhausted levels are removed.
+    std::vector<Level> levels_;
+    value_type current_;
+    bool done_ = true;
+  };
+
+  /**
+   * Genome identical to the reference sequence.
+   */
+  DeltaCompactGenome() = default;
+
+  /**
+   * Checkpoint holding a full copy of `genome`.
+   */
+  inline explicit DeltaCompactGenome(const CompactGenome& genome);
+
+  /**
+   * Genome of the child of `parent` along an edge with `mutations`.
+   */
+  inline DeltaCompactGenome(const DeltaCompactGenome& parent,
+                            const EdgeMutations& mutations,
+                            std::string_view reference_sequence,
+                            size_t checkpoint_interval = DefaultCheckpointInterval);
+
+  inline const_iterator begin() const;
+  inline const_iterator end() const;
+
+  inline bool empty() const;
+  inline std::optional<MutationBase> operator[](MutationPosition pos) const;
+  [[nodiscard]] inline bool HasMutationAtPosition(MutationPosition pos) const;
+  inline MutationBase GetBase(MutationPosition pos,
+                              std::string_view reference_sequence) const;
+
+  inline bool operator==(const DeltaCompactGenome& rhs) const;
+  inline bool operator!=(const DeltaCompactGenome& rhs) const;
+
+  /**
+   * Number of links to follow before reaching a checkpoint.
+   */
+  [[nodiscard]] inline size_t GetDepth() const;
+
+  [[nodiscard]] inline CompactGenome ToCompactGenome() const;
+
+  /**
+   * Bytes owned by this genome's own link only. Ancestor links are shared and
+   * are accounted for by the genomes of the ancestors.
+   */
+  [[nodiscard]] inline size_t HeapMemoryUsage() const;
+
+ private:
+  struct Link {
+    std::shared_ptr<const Link> parent;
+    // A default constructed MutationBase marks a position that reverted to
+    // the reference base.
+    PackedMap<MutationPosition, MutationBase> delta;
+    size_t depth = 0;
+  };
+
+  std::shared_ptr<const Link> link_;
+};
+
+/**
+ * Compute the delta genomes of all nodes of a DAG with edge mutations,
+ * following the first parent of each node as RecomputeCompactGenomes does.
+ */
+template <typename DAG>
+IdContainer<NodeId, DeltaCompactGenome, IdContinuity::Dense> ComputeDeltaCompactGenomes(
+    DAG dag,
+    size_t checkpoint_interval = DeltaCompactGenome::DefaultCheckpointInterval);
+
+#include "larch/impl/madag/delta_compact_genome_impl.hpp"
@@ -5,6 +5,8 @@
 
 #include "larch/dag/dag.hpp"
 #include "larch/contiguous_map.hpp"
+#include "larch/packed_map.hpp"
+#include "larch/madag/mutation_base.hpp"
 
 /**
  * @brief A wrapper for size_t, storing a 1-based index on the reference sequence.
@@ -28,11 +30,12 @@ inline bool operator<(MutationPosition lhs, MutationPosition rhs);
  *
  * EdgeMutations stores a collection of mutations that occur along a specific edge in
  * the tree. Each mutation is represented as a position on the reference sequence along
- * with the parent and child bases at that position. The class uses a ContiguousMap for
- * efficient storage and retrieval of mutations by position.
+ * with the parent and child bases at that position. The class uses a PackedMap, storing
+ * 32-bit positions and one byte for both bases, for compact storage and efficient
+ * retrieval of mutations by position.
  */
 class EdgeMutations {
-  ContiguousMap<MutationPosition, std::pair<MutationBase, MutationBase>> mutations_;
+  PackedMap<MutationPosition, std::pair<MutationBase, MutationBase>> mutations_;
 
  public:
   EdgeMutations() = default;
@@ -47,6 +50,15 @@ class EdgeMutations {
   inline auto end() const -> decltype(mutations_.end());
   inline size_t size() const;
   inline bool empty() const;
+  /**
+   * Sorted positions of all mutations, for merging with other sorted sets.
+   */
+  inline const std::vector<std::uint32_t>& GetPositions() const;
+  /**
+   * (parent, child) bases packed one pair per byte, see PackedBases.
+   */
+  inline const std::vector<std::uint8_t>& GetPackedBases() const;
+  [[nodiscard]] inline size_t HeapMemoryUsage() const;
   inline auto operator[](MutationPosition pos) -> decltype(mutations_[pos]);
   inline auto insert(
       std::pair<MutationPosition, std::pair<MutationBase, MutationBase>> mut);
@@ -60,8 +72,7 @@ class EdgeMutations {
 
  private:
   inline explicit EdgeMutations(
-      ContiguousMap<MutationPosition, std::pair<MutationBase, MutationBase>>&&
-          mutations);
+      PackedMap<MutationPosition, std::pair<MutationBase, MutationBase>>&& mutations);
 };
 
 template <typename CRTP, typename Tag>
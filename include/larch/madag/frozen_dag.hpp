@@ -0,0 +1,124 @@
+/**
+ * FrozenDAG is an immutable snapshot of a mutation annotated DAG, meant for
+ * read-only phases (logging, subtree weights, RF distances) that follow a
+ * merge.
+ *
+ * Node neighbors are packed into contiguous CSR-style arrays owned by the
+ * nodes container, instead of per-node vectors of vectors. Nodes reference
+ * the compact genomes of the source DAG by pointer, so the source DAG must
+ * outlive the snapshot and must not be modified while it is in use.
+ *
+ * The snapshot exposes the same read-only view API as MADAG and MergeDAG, but
+ * any attempt to modify its connections fails.
+ */
+
+#pragma once
+
+#include "larch/madag/mutation_annotated_dag.hpp"
+#include "larch/parallel/parallel_common.hpp"
+
+/**
+ * Per-node neighbors feature backed by the packed arrays stored in
+ * ExtraFeatureStorage<FrozenNeighbors>.
+ */
+struct FrozenNeighbors : Neighbors {
+  template <typename CRTP>
+  inline DAGNeighbors Copy(const CRTP* crtp) const;
+
+  template <typename CRTP>
+  auto GetParents(const CRTP* crtp) const;
+  template <typename CRTP>
+  auto GetClades(const CRTP* crtp) const;
+  template <typename CRTP>
+  auto GetLeafsBelow(const CRTP* crtp) const;
+
+  template <typename CRTP>
+  auto& GetParentsMutable(const CRTP*) {
+    Fail("Can't modify FrozenNeighbors");
+    return *Unreachable<std::vector<EdgeId>>();
+  }
+
+  template <typename CRTP>
+  auto& GetCladesMutable(const CRTP*) {
+    Fail("Can't modify FrozenNeighbors");
+    return *Unreachable<std::vector<std::vector<EdgeId>>>();
+  }
+
+  template <typename CRTP>
+  auto& GetLeafsBelowMutable(const CRTP*) {
+    Fail("Can't modify FrozenNeighbors");
+    return *Unreachable<std::vector<std::vector<NodeId>>>();
+  }
+};
+
+/**
+ * Packed connectivity of all nodes. For node `i`:
+ *  - parents are parents_[parents_offsets_[i] .. parents_offsets_[i + 1]]
+ *  - clades are clades_offsets_[i] .. clades_offsets_[i + 1], and clade `c` holds
+ *    children_[children_offsets_[c] .. children_offsets_[c + 1]]
+ *  - leafs below are laid out like clades, using leafs_below_offsets_,
+ *    leafs_offsets_ and leafs_below_
+ */
+template <>
+struct ExtraFeatureStorage<FrozenNeighbors> {
+  ExtraFeatureStorage() = default;
+  MOVE_ONLY(ExtraFeatureStorage);
+
+  std::vector<size_t> parents_offsets_;
+  std::vector<EdgeId> parents_;
+  std::vector<size_t> clades_offsets_;
+  std::vector<size_t> children_offsets_;
+  std::vector<EdgeId> children_;
+  std::vector<size_t> leafs_below_offsets_;
+  std::vector<size_t> leafs_offsets_;
+  std::vector<NodeId> leafs_below_;
+
+  size_t HeapMemoryUsage() const {
+    return ::HeapMemoryUsage(parents_offsets_) + ::HeapMemoryUsage(parents_) +
+           ::HeapMemoryUsage(clades_offsets_) + ::HeapMemoryUsage(children_offsets_) +
+           ::HeapMemoryUsage(children_) + ::HeapMemoryUsage(leafs_below_offsets_) +
+           ::HeapMemoryUsage(leafs_offsets_) + ::HeapMemoryUsage(leafs_below_);
+  }
+};
+
+template <typename CRTP, typename Tag>
+struct FeatureConstView<FrozenNeighbors, CRTP, Tag>
+    : FeatureConstView<Neighbors, CRTP, Tag> {};
+
+template <typename CRTP, typename Tag>
+struct FeatureMutableView<FrozenNeighbors, CRTP, Tag>
+    : FeatureMutableView<Neighbors, CRTP, Tag> {};
+
+struct FrozenDAGStorage;
+
+template <>
+struct LongNameOf<FrozenDAGStorage> {
+  using type = DAGStorage<
+      FrozenDAGStorage,
+      ElementsContainer<Component::Node,
+                        ElementStorage<FrozenNeighbors, Deduplicate<CompactGenome>,
+                                       SampleId>>,
+      ElementsContainer<Component::Edge, ElementStorage<DAGEndpoints, EdgeMutations>>,
+      ExtraStorage<Connections, ReferenceSequence>>;
+};
+
+struct FrozenDAGStorage : LongNameOf<FrozenDAGStorage>::type {
+  MOVE_ONLY(FrozenDAGStorage);
+
+  using LongNameType = typename LongNameOf<FrozenDAGStorage>::type;
+  using LongNameType::LongNameType;
+
+  static inline FrozenDAGStorage EmptyDefault() { return FrozenDAGStorage{}; };
+};
+
+using FrozenDAG = typename FrozenDAGStorage::ConstViewType;
+
+/**
+ * Build an immutable snapshot of a DAG with compact genomes, sample ids and
+ * edge mutations. Node and edge ids are preserved. The input DAG should have
+ * dense ids and should outlive the returned storage.
+ */
+template <typename DAG>
+FrozenDAGStorage FreezeDAG(DAG dag);
+
+#include "larch/impl/madag/frozen_dag_impl.hpp"
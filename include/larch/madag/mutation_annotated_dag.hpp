@@ -17,25 +17,35 @@
 
 #pragma once
 
+#include <limits>
+#include <numeric>
 #include <string_view>
 #include <vector>
 #include <utility>
 #include <optional>
 
 #include "larch/dag/dag.hpp"
+#include "larch/interned_sequence.hpp"
+#include "larch/parallel/parallel_common.hpp"
 #include "larch/madag/mutation_base.hpp"
 #include "larch/madag/compact_genome.hpp"
 #include "larch/madag/edge_mutations.hpp"
 #include "larch/madag/sample_id.hpp"
 
+/**
+ * The reference sequence is interned: all DAGs created with equal reference
+ * sequences share a single copy.
+ */
 struct ReferenceSequence {
   MOVE_ONLY_DEF_CTOR(ReferenceSequence);
-  std::string reference_sequence_;
+  size_t HeapMemoryUsage() const { return reference_sequence_.HeapMemoryUsage(); }
+  InternedSequence reference_sequence_;
 };
 
 template <typename CRTP, typename Tag>
 struct FeatureConstView<ReferenceSequence, CRTP, Tag> {
   const std::string& GetReferenceSequence() const;
+  const InternedSequence& GetInternedReferenceSequence() const;
   void AssertUA() const;
   bool HaveUA() const;
 };
@@ -48,10 +58,16 @@ using NodeMutMap = IdContainer<NodeId, ContiguousMap<MutationPosition, MutationB
 template <typename CRTP, typename Tag>
 struct FeatureMutableView<ReferenceSequence, CRTP, Tag> {
   void SetReferenceSequence(std::string_view reference_sequence) const;
+  void SetReferenceSequence(const InternedSequence& reference_sequence) const;
   void SetCompactGenomesFromNodeSequenceMap(const NodeSeqMap& sequence_map) const;
   void SetCompactGenomesFromNodeMutationMap(NodeMutMap&& node_mutation_map) const;
   void UpdateCompactGenomesFromNodeMutationMap(NodeMutMap&& node_mutation_map) const;
   void AddUA(const EdgeMutations& mutations_at_root) const;
+  /**
+   * Recompute compact genomes from edge mutations along first parents. Nodes
+   * are processed in waves of equal depth, each wave in parallel. Cont is kept
+   * for compatibility, node ids are indexed up to the largest id either way.
+   */
   template <IdContinuity Cont = IdContinuity::Dense>
   void RecomputeCompactGenomes(bool recompute_leaves = true) const;
   void SampleIdsFromCG(bool coerce = false) const;
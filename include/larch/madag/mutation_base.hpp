@@ -6,10 +6,14 @@
 
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <cstring>
 #include <string_view>
 #include <vector>
 
 #include "larch/contiguous_map.hpp"
+#include "larch/packed_map.hpp"
 
 struct MutationBase {
   using type = std::uint32_t;
@@ -25,13 +29,13 @@ struct MutationBase {
   }
 
   constexpr char ToChar() const noexcept {
-    const int ctz = __builtin_ctz(value);
-    const type bit = one << ctz;
-    if ((value & bit) == value) {
-      return 'A' + static_cast<char>(ctz);
-    } else {
-      return 'N';
+    if ((value & ~acgt) != 0 and value != ~zero) [[unlikely]] {
+      // a letter other than A, C, G, T or N
+      const int ctz = __builtin_ctz(value);
+      const type bit = one << ctz;
+      return (value & bit) == value ? 'A' + static_cast<char>(ctz) : 'N';
     }
+    return nibble_chars[Nibble()];
   }
 
   inline bool IsCompatible(const MutationBase& rhs) const;
@@ -44,6 +48,13 @@ struct MutationBase {
 
   static inline std::string ToString(const std::vector<MutationBase>& m_in);
 
+  /**
+   * Four-bit encoding with one bit for each of A, C, G and T, and N as all four
+   * bits set. Used to store bases in PackedMap.
+   */
+  inline std::uint8_t ToNibble() const;
+  static inline MutationBase FromNibble(std::uint8_t nibble);
+
   inline bool operator==(const MutationBase& rhs) const;
   inline bool operator!=(const MutationBase& rhs) const;
   inline bool operator<(const MutationBase& rhs) const;
@@ -81,15 +92,85 @@ struct MutationBase {
     return 'A' + static_cast<char>(__builtin_ctz(value));
   }
 
+  /**
+   * Gather the A, C, G and T bits into a nibble, N becomes 0xF.
+   */
+  constexpr std::uint8_t Nibble() const noexcept {
+    return static_cast<std::uint8_t>((value & 1) | ((value >> 1) & 2) |
+                                     ((value >> 4) & 4) | ((value >> 16) & 8));
+  }
+
   static constexpr type mask(char x) noexcept { return one << (x - 'A'); }
 
   type value;
   static constexpr const type zero = 0;
   static constexpr const type one = 1;
+  // masks of A, C, G and T, written out as mask() can't be used in the class
+  // body
+  static constexpr const type acgt = 0x1 | 0x4 | 0x40 | 0x80000;
+  static constexpr const std::array<type, 16> nibble_values = {
+      0x0,     0x1,     0x4,     0x5,     0x40,    0x41,    0x44,    0x45,
+      0x80000, 0x80001, 0x80004, 0x80005, 0x80040, 0x80041, 0x80044, ~type{0}};
+  static constexpr const std::array<char, 16> nibble_chars = {
+      'N', 'A', 'C', 'N', 'G', 'N', 'N', 'N', 'T', 'N', 'N', 'N', 'N', 'N', 'N', 'N'};
 };
 
 static_assert(std::is_trivially_copyable_v<MutationBase>);
 
+/**
+ * Batch operations on bases stored as nibbles, two per byte with the low nibble
+ * first, as PackedMap stores them. They work on 16 bases per 64-bit word with
+ * bit-parallel arithmetic instead of decoding every base.
+ */
+struct PackedBases {
+  /**
+   * Number of bases among the first `count` nibbles that are not exactly one
+   * of A, C, G or T.
+   */
+  static inline size_t CountAmbiguous(const std::uint8_t* nibbles, size_t count);
+
+  /**
+   * Whether lhs[i] and rhs[i] share a base for all i < count.
+   */
+  static inline bool AllCompatible(const std::uint8_t* lhs, const std::uint8_t* rhs,
+                                   size_t count);
+
+  /**
+   * For `count` (parent, child) pairs packed one per byte, parent in the low
+   * nibble, the number of pairs with an unambiguous child base or an ambiguous
+   * parent base. These are the mutations counted on edges to leaves by
+   * parsimony scoring.
+   */
+  static inline size_t CountLeafMutations(const std::uint8_t* pairs, size_t count);
+
+ private:
+  static inline std::uint64_t Load(const std::uint8_t* bytes, size_t size);
+  static inline std::uint64_t LowBits(size_t bits);
+  static inline std::uint64_t SingleBaseMask(std::uint64_t nibbles);
+  static inline std::uint64_t NonZeroMask(std::uint64_t nibbles);
+};
+
+template <>
+struct PackedValueTraits<MutationBase> {
+  static constexpr size_t bits = 4;
+  static std::uint8_t Encode(MutationBase base) { return base.ToNibble(); }
+  static MutationBase Decode(std::uint8_t code) {
+    return MutationBase::FromNibble(code);
+  }
+};
+
+template <>
+struct PackedValueTraits<std::pair<MutationBase, MutationBase>> {
+  static constexpr size_t bits = 8;
+  static std::uint8_t Encode(std::pair<MutationBase, MutationBase> bases) {
+    return static_cast<std::uint8_t>(bases.first.ToNibble() |
+                                     (bases.second.ToNibble() << 4));
+  }
+  static std::pair<MutationBase, MutationBase> Decode(std::uint8_t code) {
+    return {MutationBase::FromNibble(code & 0xF), MutationBase::FromNibble(code >> 4)};
+  }
+};
+
 namespace std {
 template <>
 struct hash<MutationBase> {
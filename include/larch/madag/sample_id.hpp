@@ -1,5 +1,10 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+
 #include <boost/unordered/unordered_set.hpp>
 
 class SampleIdStorage;
@@ -23,26 +28,47 @@ struct std::equal_to<SampleIdStorage> {
  * unique sample identifier string is stored only once in memory. It provides fast
  * hash-based comparison and lookup operations. This class is used internally by
  * SampleId and should not be used directly.
+ *
+ * The interned values are split into shards by hash, each with its own lock, so
+ * that parallel loaders and merges don't serialize on a single mutex. Every value
+ * also gets a dense index, 0..GetCount()-1 in order of interning, for use in flat
+ * arrays and bitsets.
  */
 class SampleIdStorage {
  public:
   inline size_t Hash() const { return hash_; }
   inline const std::string& Value() const { return value_; }
+  inline size_t Index() const { return index_; }
 
   static const SampleIdStorage& Get(std::string_view x) {
-    std::shared_lock read_lock{mtx_};
-    auto result = values_.find(x);
-    if (result != values_.end()) {
+    const size_t hash = std::hash<std::string_view>{}(x);
+    Shard& shard = GetShard(hash);
+    std::shared_lock read_lock{shard.mtx_};
+    auto result = shard.values_.find(x);
+    if (result != shard.values_.end()) {
       return *result;
     }
     read_lock.unlock();
-    std::unique_lock write_lock{mtx_};
-    return *values_.emplace(SampleIdStorage{std::string{x}}).first;
+    std::unique_lock write_lock{shard.mtx_};
+    // another thread may have inserted it in between, and the index must only
+    // be taken once per value
+    result = shard.values_.find(x);
+    if (result != shard.values_.end()) {
+      return *result;
+    }
+    return *shard.values_
+                .emplace(SampleIdStorage{std::string{x}, hash, count_.fetch_add(1)})
+                .first;
   }
 
+  /**
+   * Number of interned values, an upper bound of all indices.
+   */
+  static size_t GetCount() { return count_.load(); }
+
  private:
-  SampleIdStorage(std::string value)
-      : hash_{std::hash<std::string>{}(value)}, value_{std::move(value)} {}
+  SampleIdStorage(std::string value, size_t hash, size_t index)
+      : hash_{hash}, index_{index}, value_{std::move(value)} {}
 
   struct key_hash {
     using is_transparent = void;
@@ -63,11 +89,25 @@ class SampleIdStorage {
     }
   };
 
-  static inline boost::unordered_set<SampleIdStorage, key_hash, key_equal> values_{
-      1000, key_hash{}, key_equal{}};
-  static inline std::shared_mutex mtx_;
+  static constexpr size_t ShardCount = 64;
+
+  // node based, so references to values stay valid when a shard grows
+  struct alignas(64) Shard {
+    boost::unordered_set<SampleIdStorage, key_hash, key_equal> values_{
+        64, key_hash{}, key_equal{}};
+    std::shared_mutex mtx_;
+  };
+
+  static Shard& GetShard(size_t hash) {
+    static std::array<Shard, ShardCount> shards;
+    // the low bits pick buckets within a shard, use the high bits here
+    return shards.at((hash >> 32) % ShardCount);
+  }
+
+  static inline std::atomic<size_t> count_{0};
 
   const size_t hash_;
+  const size_t index_;
   const std::string value_;
 };
 
@@ -119,6 +159,21 @@ struct SampleId {
     return target_->Hash();
   }
 
+  /**
+   * Dense index of this id among all interned sample ids, or NoId if empty.
+   */
+  inline size_t GetIndex() const {
+    if (not target_) {
+      return NoId;
+    }
+    return target_->Index();
+  }
+
+  /**
+   * Upper bound of all indices returned by GetIndex().
+   */
+  inline static size_t GetIndexCount() { return SampleIdStorage::GetCount(); }
+
   inline static UniqueData GetEmpty();
 
  private:
@@ -188,6 +243,10 @@ struct FeatureConstView<SampleId, CRTP, Tag> {
   std::optional<std::string_view> GetSampleId() const;
 
   inline bool HaveSampleId() const { return not GetFeatureStorage(this).get().empty(); }
+
+  inline size_t GetSampleIdIndex() const {
+    return GetFeatureStorage(this).get().GetIndex();
+  }
 };
 
 template <typename CRTP, typename Tag>
@@ -0,0 +1,64 @@
+/**
+ * SiteMutationIndex maps each site of the reference sequence to the edges
+ * whose EdgeMutations have an entry at that site, so that site-restricted
+ * analyses don't need to scan every edge of the DAG.
+ *
+ * The index is built in parallel from a DAG with edge mutations, and can be
+ * kept up to date incrementally with AddEdge, RemoveEdge and UpdateEdge when
+ * edges or their mutations change. Edges of each site are kept sorted by id.
+ */
+
+#pragma once
+
+#include <numeric>
+#include <vector>
+
+#include "larch/madag/edge_mutations.hpp"
+#include "larch/madag/mutation_base.hpp"
+#include "larch/parallel/parallel_common.hpp"
+#include "larch/sorted_set_kernels.hpp"
+
+class SiteMutationIndex {
+ public:
+  MOVE_ONLY_DEF_CTOR(SiteMutationIndex);
+
+  /**
+   * Index all edges of `dag`, for sites 1..reference_sequence.size().
+   */
+  template <typename DAG>
+  static SiteMutationIndex Build(DAG dag);
+
+  /**
+   * Edges with a mutation at `pos`, sorted by id.
+   */
+  inline const std::vector<EdgeId>& GetEdges(MutationPosition pos) const;
+
+  /**
+   * Child nodes of the edges with a mutation at `pos`.
+   */
+  template <typename DAG>
+  std::vector<NodeId> GetNodes(DAG dag, MutationPosition pos) const;
+
+  inline size_t GetCount(MutationPosition pos) const;
+
+  /**
+   * Sites that are mutated on at least one edge, in increasing order.
+   */
+  inline std::vector<MutationPosition> GetSites() const;
+
+  inline void AddEdge(EdgeId edge, const EdgeMutations& mutations);
+  inline void RemoveEdge(EdgeId edge, const EdgeMutations& mutations);
+  inline void UpdateEdge(EdgeId edge, const EdgeMutations& old_mutations,
+                         const EdgeMutations& new_mutations);
+
+  [[nodiscard]] inline size_t HeapMemoryUsage() const;
+
+ private:
+  inline void Add(EdgeId edge, MutationPosition pos);
+  inline void Remove(EdgeId edge, MutationPosition pos);
+
+  // indexed by site, entry 0 is unused as sites are 1-based
+  std::vector<std::vector<EdgeId>> edges_by_site_;
+};
+
+#include "larch/impl/madag/site_mutation_index_impl.hpp"
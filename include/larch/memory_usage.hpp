@@ -0,0 +1,169 @@
+#pragma once
+
+#include <array>
+#include <map>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <typeinfo>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <boost/core/demangle.hpp>
+
+#include "larch/common.hpp"
+
+/**
+ * Bytes used by a data structure, broken down by named component. Entry names
+ * are slash-separated paths, e.g. "nodes/CompactGenome".
+ */
+class MemoryUsageReport {
+ public:
+  inline void Add(std::string_view name, size_t bytes) {
+    entries_[std::string{name}] += bytes;
+  }
+
+  inline void Add(std::string_view prefix, const MemoryUsageReport& other) {
+    for (auto& [name, bytes] : other.entries_) {
+      Add(std::string{prefix} + "/" + name, bytes);
+    }
+  }
+
+  [[nodiscard]] inline size_t Total() const {
+    size_t result = 0;
+    for (auto& [name, bytes] : entries_) {
+      result += bytes;
+    }
+    return result;
+  }
+
+  [[nodiscard]] inline const std::map<std::string, size_t>& GetEntries() const {
+    return entries_;
+  }
+
+ private:
+  std::map<std::string, size_t> entries_;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const MemoryUsageReport& report) {
+  for (auto& [name, bytes] : report.GetEntries()) {
+    os << name << '\t' << bytes << '\n';
+  }
+  os << "total\t" << report.Total() << '\n';
+  return os;
+}
+
+template <typename T>
+std::string MemoryUsageName() {
+  return boost::core::demangle(typeid(T).name());
+}
+
+template <typename T, typename = void>
+struct HasHeapMemoryUsage : std::false_type {};
+
+template <typename T>
+struct HasHeapMemoryUsage<
+    T, std::void_t<decltype(std::declval<const T&>().HeapMemoryUsage())>>
+    : std::true_type {};
+
+/**
+ * Bytes of heap memory owned by `value`, not counting sizeof(value) itself.
+ * Types that own heap allocations other than the standard containers handled
+ * here should provide a `size_t HeapMemoryUsage() const` member. Pointers and
+ * non-owning handles count as zero.
+ */
+template <typename T>
+size_t HeapMemoryUsage(const T& value) {
+  if constexpr (HasHeapMemoryUsage<T>::value) {
+    return value.HeapMemoryUsage();
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    // short strings are stored inline
+    return value.capacity() > std::string{}.capacity() ? value.capacity() + 1 : 0;
+  } else if constexpr (is_specialization_v<T, std::vector>) {
+    size_t result = value.capacity() * sizeof(typename T::value_type);
+    if constexpr (not std::is_trivially_copyable_v<typename T::value_type>) {
+      for (auto& i : value) {
+        result += HeapMemoryUsage(i);
+      }
+    }
+    return result;
+  } else if constexpr (is_specialization_v<T, std::pair>) {
+    return HeapMemoryUsage(value.first) + HeapMemoryUsage(value.second);
+  } else if constexpr (is_specialization_v<T, std::tuple>) {
+    return std::apply([](auto&... i) { return (size_t{0} + ... + HeapMemoryUsage(i)); },
+                      value);
+  } else if constexpr (is_specialization_v<T, std::optional>) {
+    return value.has_value() ? HeapMemoryUsage(*value) : 0;
+  } else if constexpr (is_specialization_v<T, std::unordered_map> or
+                       is_specialization_v<T, std::unordered_set>) {
+    // bucket array, plus one node per element holding the value, the next
+    // pointer and the cached hash
+    size_t result =
+        value.bucket_count() * sizeof(void*) +
+        value.size() * (sizeof(typename T::value_type) + 2 * sizeof(void*));
+    if constexpr (not std::is_trivially_copyable_v<typename T::value_type>) {
+      for (auto& i : value) {
+        result += HeapMemoryUsage(i);
+      }
+    }
+    return result;
+  } else if constexpr (is_specialization_v<T, std::map> or
+                       is_specialization_v<T, std::set>) {
+    // one red-black tree node per element: three pointers and a color
+    size_t result =
+        value.size() * (sizeof(typename T::value_type) + 4 * sizeof(void*));
+    if constexpr (not std::is_trivially_copyable_v<typename T::value_type>) {
+      for (auto& i : value) {
+        result += HeapMemoryUsage(i);
+      }
+    }
+    return result;
+  } else {
+    return 0;
+  }
+}
+
+/**
+ * Accumulates the memory of many tuples of features, one counter per feature
+ * type, and reports them under the features' names.
+ */
+template <typename... Fs>
+struct FeaturesMemoryUsage {
+  void Accumulate(const std::tuple<Fs...>& features) {
+    Accumulate(features, std::index_sequence_for<Fs...>{});
+  }
+
+  void AddTo(MemoryUsageReport& report, std::string_view suffix = {}) const {
+    AddTo(report, suffix, std::index_sequence_for<Fs...>{});
+  }
+
+ private:
+  template <size_t... I>
+  void Accumulate(const std::tuple<Fs...>& features, std::index_sequence<I...>) {
+    ((bytes_[I] += sizeof(Fs) + HeapMemoryUsage(std::get<I>(features))), ...);
+  }
+
+  template <size_t... I>
+  void AddTo(MemoryUsageReport& report, std::string_view suffix,
+             std::index_sequence<I...>) const {
+    (AddEntry<Fs>(report, suffix, bytes_[I]), ...);
+  }
+
+  template <typename F>
+  static void AddEntry(MemoryUsageReport& report, std::string_view suffix,
+                       size_t bytes) {
+    // skip tag-only features and empty extra storages
+    if constexpr (not std::is_empty_v<F>) {
+      report.Add(MemoryUsageName<F>() + std::string{suffix}, bytes);
+    }
+  }
+
+  std::array<size_t, sizeof...(Fs)> bytes_ = {};
+};
+
+template <typename... Fs>
+struct FeaturesMemoryUsage<std::tuple<Fs...>> : FeaturesMemoryUsage<Fs...> {};
@@ -2,6 +2,7 @@
 
 #include "larch/common.hpp"
 #include "larch/madag/sample_id.hpp"
+#include "larch/memory_usage.hpp"
 
 class NodeLabel;
 
@@ -35,6 +36,8 @@ class LeafSet {
   inline bool empty() const;
   inline size_t size() const;
 
+  [[nodiscard]] inline size_t HeapMemoryUsage() const;
+
   [[nodiscard]] inline std::vector<UniqueData> ToParentClade(
       UniqueData sample_id) const;
 
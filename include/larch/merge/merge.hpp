@@ -80,6 +80,17 @@ class Merge {
 
   inline const GrowableHashMap<std::string, CompactGenome>& SampleIdToCGMap() const;
 
+  /**
+   * Nodes of the resulting DAG created by AddDAGs since the last call to
+   * ClearUpdatedNodes, and the existing nodes that gained child edges, in no
+   * particular order and possibly repeated. Everything computed below the
+   * other nodes, e.g. by SubtreeWeight, is unaffected by these merges. Not
+   * synchronized with concurrent AddDAGs.
+   */
+  inline const std::vector<NodeId>& GetUpdatedNodes() const;
+
+  inline void ClearUpdatedNodes();
+
   /**
    * Compute the mutations on the resulting DAG's edges and store in the result MADAG.
    */
@@ -87,6 +98,12 @@ class Merge {
 
   inline bool ContainsLeafset(const LeafSet& leafset) const;
 
+  /**
+   * Bytes used by the resulting DAG and by the hash tables of labels, leaf sets
+   * and sample compact genomes kept for merging.
+   */
+  inline MemoryUsageReport MemoryUsage() const;
+
  private:
   inline MutableMergeDAG ResultDAG();
 
@@ -131,6 +148,9 @@ class Merge {
   // merge purposes.
   GrowableHashMap<std::string, CompactGenome> sample_id_to_cg_map_{32};
 
+  // Nodes added or given new child edges by AddDAGs, see GetUpdatedNodes.
+  std::vector<NodeId> updated_nodes_;
+
   std::mutex add_dags_mtx_;
 };
 
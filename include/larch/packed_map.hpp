@@ -0,0 +1,347 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+#include "larch/memory_usage.hpp"
+
+/**
+ * Describes how values are packed into a PackedMap. Specializations provide:
+ *  - `static constexpr size_t bits`: 4 or 8
+ *  - `static std::uint8_t Encode(const V&)`
+ *  - `static V Decode(std::uint8_t)`
+ * Encode(V{}) must be zero.
+ */
+template <typename V>
+struct PackedValueTraits;
+
+/**
+ * Sorted map with the same interface as ContiguousMap, for keys that fit in 32
+ * bits and values that fit in 4 or 8 bits. Keys are stored in one array and
+ * values are bit-packed in another, so a 4-bit value costs 4.5 bytes per entry
+ * instead of 16 for std::pair<size_t, uint32_t>.
+ *
+ * K is a wrapper with a `value` member, e.g. MutationPosition. Iterators yield
+ * std::pair<K, V> by value, so elements can't be modified in place; use
+ * insert_or_assign or operator[] instead.
+ */
+template <typename K, typename V>
+class PackedMap {
+  using Traits = PackedValueTraits<V>;
+  static constexpr size_t ValueBits = Traits::bits;
+  static_assert(ValueBits == 4 or ValueBits == 8);
+  static constexpr size_t ValuesPerByte = 8 / ValueBits;
+  static constexpr std::uint8_t ValueMask = (1u << ValueBits) - 1;
+
+ public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = std::pair<K, V>;
+
+  class const_iterator {
+   public:
+    using iterator_concept = std::bidirectional_iterator_tag;
+    using iterator_category = std::input_iterator_tag;
+    using value_type = PackedMap::value_type;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type;
+    using pointer = void;
+
+    struct ArrowProxy {
+      value_type value;
+      const value_type* operator->() const { return &value; }
+    };
+
+    const_iterator() = default;
+
+    value_type operator*() const { return map_->Get(index_); }
+    ArrowProxy operator->() const { return {**this}; }
+
+    const_iterator& operator++() {
+      ++index_;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      auto result = *this;
+      ++index_;
+      return result;
+    }
+    const_iterator& operator--() {
+      --index_;
+      return *this;
+    }
+    const_iterator operator--(int) {
+      auto result = *this;
+      --index_;
+      return result;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return index_ == other.index_;
+    }
+    bool operator!=(const const_iterator& other) const {
+      return index_ != other.index_;
+    }
+
+    size_t GetIndex() const { return index_; }
+
+   private:
+    friend class PackedMap;
+    const_iterator(const PackedMap* map, size_t index) : map_{map}, index_{index} {}
+    const PackedMap* map_ = nullptr;
+    size_t index_ = 0;
+  };
+  using iterator = const_iterator;
+
+  /**
+   * Returned by operator[], assigning to it updates the packed value.
+   */
+  class Reference {
+   public:
+    Reference& operator=(const V& value) {
+      map_->SetValue(index_, value);
+      return *this;
+    }
+    Reference& operator=(const Reference& other) {
+      return *this = static_cast<V>(other);
+    }
+    operator V() const { return map_->GetValue(index_); }
+
+   private:
+    friend class PackedMap;
+    Reference(PackedMap* map, size_t index) : map_{map}, index_{index} {}
+    PackedMap* map_;
+    size_t index_;
+  };
+
+  PackedMap() = default;
+  PackedMap(PackedMap&&) noexcept = default;
+  PackedMap& operator=(PackedMap&&) noexcept = default;
+  PackedMap& operator=(const PackedMap&) = delete;
+  ~PackedMap() = default;
+
+  PackedMap Copy() const { return PackedMap{*this}; }
+
+  const_iterator begin() const { return {this, 0}; }
+
+  const_iterator end() const { return {this, size()}; }
+
+  const_iterator find(const K& key) const {
+    size_t index = Find(key);
+    if (index < size() and keys_[index] == key.value) {
+      return {this, index};
+    }
+    return end();
+  }
+
+  bool operator==(const PackedMap& other) const {
+    // unused trailing bits are always zero, so the packed arrays can be
+    // compared directly
+    return keys_ == other.keys_ and values_ == other.values_;
+  }
+
+  bool operator!=(const PackedMap& other) const { return not(*this == other); }
+
+  bool operator<(const PackedMap& other) const {
+    return std::lexicographical_compare(begin(), end(), other.begin(), other.end());
+  }
+
+  bool empty() const { return keys_.empty(); }
+
+  size_t size() const { return keys_.size(); }
+
+  size_t HeapMemoryUsage() const {
+    return ::HeapMemoryUsage(keys_) + ::HeapMemoryUsage(values_);
+  }
+
+  void clear() {
+    keys_.clear();
+    values_.clear();
+  }
+
+  void reserve(size_t size) {
+    keys_.reserve(size);
+    values_.reserve(BytesFor(size));
+  }
+
+  void erase(const_iterator it) {
+    const size_t index = it.GetIndex();
+    Assert(index < size());
+    keys_.erase(keys_.begin() + static_cast<std::ptrdiff_t>(index));
+    if constexpr (ValuesPerByte == 1) {
+      values_.erase(values_.begin() + static_cast<std::ptrdiff_t>(index));
+    } else {
+      const size_t count = keys_.size();
+      for (size_t i = index; i < count; ++i) {
+        SetCode(i, GetCode(i + 1));
+      }
+      SetCode(count, 0);
+      values_.resize(BytesFor(count));
+    }
+  }
+
+  std::pair<const_iterator, bool> insert(const value_type& value) {
+    size_t index = Find(value.first);
+    if (index < size() and keys_[index] == value.first.value) {
+      return {{this, index}, false};
+    }
+    Insert(index, value.first, value.second);
+    return {{this, index}, true};
+  }
+
+  template <typename Mapped>
+  std::pair<const_iterator, bool> insert_or_assign(const K& key, Mapped&& value) {
+    size_t index = Find(key);
+    if (index < size() and keys_[index] == key.value) {
+      SetValue(index, std::forward<Mapped>(value));
+      return {{this, index}, false};
+    }
+    Insert(index, key, std::forward<Mapped>(value));
+    return {{this, index}, true};
+  }
+
+  /**
+   * Append an element with a key greater than all keys in the map.
+   */
+  void push_back(const K& key, const V& value) {
+    Assert(empty() or keys_.back() < key.value);
+    keys_.push_back(CheckedKey(key));
+    const size_t count = keys_.size();
+    values_.resize(BytesFor(count));
+    SetCode(count - 1, Traits::Encode(value));
+  }
+
+  Reference operator[](const K& key) {
+    size_t index = Find(key);
+    if (not(index < size() and keys_[index] == key.value)) {
+      Insert(index, key, V{});
+    }
+    return {this, index};
+  }
+
+  V at(const K& key) const {
+    auto it = find(key);
+    Assert(it != end());
+    return GetValue(it.GetIndex());
+  }
+
+  bool Contains(const K& key) const { return find(key) != end(); }
+
+  /**
+   * Add all elements of `other` with keys not present in this map.
+   */
+  void Union(const PackedMap& other) {
+    PackedMap result;
+    result.reserve(size() + other.size());
+    size_t i = 0;
+    size_t j = 0;
+    while (i < size() or j < other.size()) {
+      if (j == other.size() or (i < size() and keys_[i] <= other.keys_[j])) {
+        if (j < other.size() and keys_[i] == other.keys_[j]) {
+          ++j;
+        }
+        result.PushCode(keys_[i], GetCode(i));
+        ++i;
+      } else {
+        result.PushCode(other.keys_[j], other.GetCode(j));
+        ++j;
+      }
+    }
+    *this = std::move(result);
+  }
+
+  /**
+   * Raw access for merge-style algorithms that walk two maps in lockstep.
+   */
+  const std::vector<std::uint32_t>& GetKeys() const { return keys_; }
+
+  V GetValue(size_t index) const { return Traits::Decode(GetCode(index)); }
+
+  /**
+   * Values packed as ValueBits codes, low bits first. Unused trailing bits of
+   * the last byte are zero.
+   */
+  const std::vector<std::uint8_t>& GetPackedValues() const { return values_; }
+
+ private:
+  PackedMap(const PackedMap&) = default;
+
+  static size_t BytesFor(size_t count) {
+    return (count + ValuesPerByte - 1) / ValuesPerByte;
+  }
+
+  static std::uint32_t CheckedKey(const K& key) {
+    Assert(key.value <= std::numeric_limits<std::uint32_t>::max());
+    return static_cast<std::uint32_t>(key.value);
+  }
+
+  value_type Get(size_t index) const {
+    return {K{keys_[index]}, GetValue(index)};
+  }
+
+  size_t Find(const K& key) const {
+    return static_cast<size_t>(
+        std::lower_bound(keys_.begin(), keys_.end(), key.value) - keys_.begin());
+  }
+
+  std::uint8_t GetCode(size_t index) const {
+    if constexpr (ValuesPerByte == 1) {
+      return values_[index];
+    } else {
+      const size_t shift = (index % ValuesPerByte) * ValueBits;
+      return (values_[index / ValuesPerByte] >> shift) & ValueMask;
+    }
+  }
+
+  void SetCode(size_t index, std::uint8_t code) {
+    Assert((code & ValueMask) == code);
+    if constexpr (ValuesPerByte == 1) {
+      values_[index] = code;
+    } else {
+      const size_t shift = (index % ValuesPerByte) * ValueBits;
+      std::uint8_t& byte = values_[index / ValuesPerByte];
+      byte = static_cast<std::uint8_t>((byte & ~(ValueMask << shift)) |
+                                       (code << shift));
+    }
+  }
+
+  void SetValue(size_t index, const V& value) { SetCode(index, Traits::Encode(value)); }
+
+  void PushCode(std::uint32_t key, std::uint8_t code) {
+    keys_.push_back(key);
+    const size_t count = keys_.size();
+    values_.resize(BytesFor(count));
+    SetCode(count - 1, code);
+  }
+
+  void Insert(size_t index, const K& key, const V& value) {
+    keys_.insert(keys_.begin() + static_cast<std::ptrdiff_t>(index), CheckedKey(key));
+    const std::uint8_t code = Traits::Encode(value);
+    if constexpr (ValuesPerByte == 1) {
+      values_.insert(values_.begin() + static_cast<std::ptrdiff_t>(index), code);
+    } else {
+      const size_t count = keys_.size();
+      values_.resize(BytesFor(count));
+      for (size_t i = count - 1; i > index; --i) {
+        SetCode(i, GetCode(i - 1));
+      }
+      SetCode(index, code);
+    }
+  }
+
+  std::vector<std::uint32_t> keys_;
+  std::vector<std::uint8_t> values_;
+};
+
+template <typename K, typename V>
+inline std::ostream& operator<<(std::ostream& os, const PackedMap<K, V>& map) {
+  os << "{ ";
+  for (const auto& [key, value] : map) {
+    os << key << ": " << value << ", ";
+  }
+  os << "}";
+  return os;
+}
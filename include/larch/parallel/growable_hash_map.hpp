@@ -5,6 +5,7 @@
 #include <unordered_set>
 
 #include "larch/fixed_array.hpp"
+#include "larch/memory_usage.hpp"
 #include "larch/parallel/parallel_common.hpp"
 
 template <typename K, typename V>
@@ -128,6 +129,18 @@ class GrowableHashMap {
     return result;
   }
 
+  /**
+   * Approximate heap memory used by the buckets and their contents.
+   */
+  [[nodiscard]] size_t HeapMemoryUsage() const {
+    size_t result = buckets_.size() * sizeof(Bucket);
+    for (auto& i : buckets_) {
+      auto rlock = ReadLock(i.mutex_);
+      result += ::HeapMemoryUsage(i.data_);
+    }
+    return result;
+  }
+
  private:
   struct Bucket {
     mutable std::shared_mutex mutex_;
@@ -186,6 +199,18 @@ class GrowableHashSet {
     return std::addressof(*result);
   }
 
+  /**
+   * Approximate heap memory used by the buckets and their contents.
+   */
+  [[nodiscard]] size_t HeapMemoryUsage() const {
+    size_t result = buckets_.size() * sizeof(Bucket);
+    for (auto& i : buckets_) {
+      auto rlock = ReadLock(i.mutex_);
+      result += ::HeapMemoryUsage(i.data_);
+    }
+    return result;
+  }
+
  private:
   struct Bucket {
     mutable std::shared_mutex mutex_;
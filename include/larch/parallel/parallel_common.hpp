@@ -62,3 +62,20 @@ void ParallelForEach(Range&& range, F&& func) {
   }
 #endif
 }
+
+// Waves narrower than this, as in deep caterpillar-like DAGs, aren't worth a
+// task per item.
+inline constexpr std::ptrdiff_t MinParallelWaveSize = 64;
+
+/**
+ * Apply `func` to the items of one wave of a level-by-level traversal, whose
+ * items don't depend on each other. Narrow waves are processed sequentially.
+ */
+template <typename Range, typename F>
+void WaveForEach(Range&& wave, F&& func) {
+  if (ranges::distance(wave) < MinParallelWaveSize) {
+    SeqForEach(std::forward<Range>(wave), std::forward<F>(func));
+  } else {
+    ParallelForEach(std::forward<Range>(wave), std::forward<F>(func));
+  }
+}
@@ -3,100 +3,163 @@ computing the summed RF distance over all trees in the DAG.
 This routine requires 4 traversals of the nodes in DAG to calculate the rf distance
 sums:
 - one postorder traversal to assign subtree counts below each node, and
-- one in a preorder traversal that uses the subtree counts and computes above-tree
-counts
+- one preorder pass, in parallel waves, that uses the subtree counts and computes
+above-tree counts
 - a loop over the nodes (in any order) accumulates the two types of counts and saves
-them in an accumulation based on unique leafsets
+them in an accumulation keyed by 128-bit clade hashes, which are computed once per
+unique leafset of both DAGs
 - finally, a postorder traversal to calculate the sums of RF distances between trees in
 a dag and all the trees in a reference, using the methods provided by a
 SubtreeWeight<SumRFDistance, DAGTYPE> object.
 */
 #pragma once
 
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
 #include "larch/subtree/subtree_weight.hpp"
 #include "larch/subtree/tree_count.hpp"
 #include "larch/subtree/simple_weight_ops.hpp"
 #include "larch/merge/merge.hpp"
 
-template <typename SubtreeWeight, typename Node>
-ArbitraryInt ComputeAboveTreeCount(Node node,
-                                   std::vector<ArbitraryInt>& above_tree_counts,
-                                   SubtreeWeight& cached_below_tree_counts) {
-  /* This routine takes an argument that is a cached subtreeWeight
-   * `cached_below_tree_counts'. If this subtreeWeight is the TreeCount weight (which
-   * returns the number of subtrees below each node), then this routine computes the
-   * number of trees "above" a given node. A tree is "above" the node if it contains the
-   * node, and taking the graph union with a subtree below that node yields a tree on
-   * the full leaf set that belongs in the DAG.
-   */
-
-  if (above_tree_counts.at(node.GetId().value) > 0) {
-    return above_tree_counts.at(node.GetId().value);
-  } else if (node.IsUA()) {
-    above_tree_counts.at(node.GetId().value) = 1;
-    return 1;
-  }
+/**
+ * Number of trees "above" every node of `dag`, indexed by node id, given the
+ * cached TreeCount weight `below_tree_counts` (the number of subtrees below each
+ * node). A tree is "above" the node if it contains the node, and taking the
+ * graph union with a subtree below that node yields a tree on the full leaf set
+ * that belongs in the DAG.
+ *
+ * The counts are computed top-down in waves of nodes whose parents are all
+ * done, each node once, so the cost is linear in the size of the DAG.
+ */
+template <typename DAG>
+std::vector<CheckedCount> ComputeAboveTreeCounts(
+    DAG dag, SubtreeWeight<TreeCount, DAG>& below_tree_counts) {
+  const size_t nodes_count = dag.GetNodesCount();
+  below_tree_counts.ComputeWeightBelow(dag.GetRoot(), {});
+  std::vector<NodeId> node_ids =
+      dag.GetNodes() | Transform::GetId() | ranges::to_vector;
 
-  ArbitraryInt above = 0;
-  for (auto parent_edge : node.GetParents()) {
-    auto parent_node = parent_edge.GetParent();
-    auto current_clade = parent_node.GetClade(parent_edge.GetClade());
-    ArbitraryInt below_parent = 1;
-
-    for (auto clade : parent_node.GetClades()) {
-      if (not ranges::equal(clade, current_clade)) {
-        // sum up the list of values {cached_below_tree_counts[edge] : edge in clade}
-        auto below_clade = ranges::accumulate(
-            clade | ranges::views::transform([&cached_below_tree_counts](auto edge) {
-              return cached_below_tree_counts.ComputeWeightBelow(edge.GetChild(), {});
-            }),
-            ArbitraryInt{0});
-        // multiply these sums across all the (other) clades below the current parent
-        // node
-        below_parent *= below_clade;
+  // For every node and clade, the product of the below counts of the node's
+  // other clades, from prefix and suffix products of the clade sums.
+  std::vector<std::vector<CheckedCount>> other_clades(nodes_count);
+  ParallelForEach(node_ids, [&](NodeId id) {
+    std::vector<CheckedCount> clade_sums;
+    for (auto clade : dag.Get(id).GetClades()) {
+      CheckedCount sum = 0;
+      for (auto edge : clade) {
+        sum += below_tree_counts.ComputeWeightBelow(edge.GetChild(), {});
       }
+      clade_sums.push_back(std::move(sum));
+    }
+    auto& others = other_clades.at(id.value);
+    others.resize(clade_sums.size());
+    CheckedCount prefix = 1;
+    for (size_t i = 0; i < clade_sums.size(); ++i) {
+      others[i] = prefix;
+      prefix *= clade_sums[i];
+    }
+    CheckedCount suffix = 1;
+    for (size_t i = clade_sums.size(); i-- > 0;) {
+      others[i] *= suffix;
+      suffix *= clade_sums[i];
     }
-    // sum all values over parents for current node
-    above += ComputeAboveTreeCount(parent_node, above_tree_counts,
-                                   cached_below_tree_counts) *
-             below_parent;
+  });
+
+  // A node joins the next wave once all of its parents have been reached.
+  std::vector<size_t> pending_parents(nodes_count, 0);
+  for (NodeId id : node_ids) {
+    pending_parents.at(id.value) = dag.Get(id).GetParentsCount();
+  }
+  std::vector<std::vector<NodeId>> waves{{dag.GetRoot().GetId()}};
+  while (not waves.back().empty()) {
+    std::vector<NodeId> next;
+    for (NodeId id : waves.back()) {
+      for (auto child_edge : dag.Get(id).GetChildren()) {
+        const NodeId child = child_edge.GetChildId();
+        if (--pending_parents.at(child.value) == 0) {
+          next.push_back(child);
+        }
+      }
+    }
+    waves.push_back(std::move(next));
+  }
+
+  std::vector<CheckedCount> above(nodes_count, 0);
+  above.at(dag.GetRoot().GetId().value) = 1;
+  // each task writes only its own node, and reads the parents of earlier waves
+  auto compute_above = [&](NodeId id) {
+    CheckedCount sum = 0;
+    for (auto parent_edge : dag.Get(id).GetParents()) {
+      const NodeId parent = parent_edge.GetParentId();
+      sum += above.at(parent.value) *
+             other_clades.at(parent.value).at(parent_edge.GetClade().value);
+    }
+    above.at(id.value) = std::move(sum);
+  };
+  for (size_t wave = 1; wave < waves.size(); ++wave) {
+    WaveForEach(waves[wave], compute_above);
   }
-  above_tree_counts.at(node.GetId().value) = above;
   return above;
 }
 
-struct LeafSetKey {
-  size_t operator()(const LeafSet* key) const {
-    size_t hash = 0;
-    for (const auto& clade : key->GetClades()) {
-      for (UniqueData leaf : clade) {
-        hash = HashCombine(hash, leaf.Hash());
-      }
-    }
-    return hash;
+/**
+ * 128-bit hash of a set of leaves: the wrapping sum of a 128-bit mix of each
+ * leaf's sample id index. Sample ids are interned process-wide, so the hashes
+ * of equal clades agree between different DAGs.
+ */
+__extension__ typedef unsigned __int128 CladeHash;
+
+struct CladeHashKey {
+  size_t operator()(CladeHash hash) const noexcept {
+    return static_cast<size_t>(hash) ^ static_cast<size_t>(hash >> 64);
   }
+};
+
+inline CladeHash LeafCladeHash(size_t sample_index) {
+  Assert(sample_index != NoId);
+  // two seeds, a bijection of the index in each half
+  const std::uint64_t index = sample_index;
+  return (static_cast<CladeHash>(SplitMix64(index + 0x9e3779b97f4a7c15)) << 64) |
+         SplitMix64(index + 0x3c6ef372fe94f82a);
+}
+
+inline CladeHash LeafCladeHash(UniqueData leaf) {
+  return LeafCladeHash(leaf.GetIndex());
+}
 
-  bool operator()(const LeafSet* lhs, const LeafSet* rhs) const {
-    auto& lhs_clades = lhs->GetClades();
-    auto& rhs_clades = rhs->GetClades();
-    if (lhs_clades.size() != rhs_clades.size()) {
-      return false;
+/**
+ * Clade hash of the leaves below every node of the merge result, indexed by
+ * node id. Nodes with the same leaf set share a LeafSet in the merge, so each
+ * leaf set is hashed once.
+ */
+inline std::vector<CladeHash> ComputeCladeHashes(const Merge& merge) {
+  std::vector<CladeHash> result(merge.GetResult().GetNodesCount(), 0);
+  std::unordered_map<const LeafSet*, CladeHash> leafset_hashes;
+  for (auto node : merge.GetResult().GetNodes()) {
+    if (node.IsUA()) {
+      continue;
     }
-    for (size_t i = 0; i < lhs_clades.size(); ++i) {
-      auto& lhs_clade = lhs_clades[i];
-      auto& rhs_clade = rhs_clades[i];
-      if (lhs_clade.size() != rhs_clade.size()) {
-        return false;
-      }
-      for (size_t j = 0; j < lhs_clade.size(); ++j) {
-        if (not std::equal_to<SampleId>{}(lhs_clade[j], rhs_clade[j])) {
-          return false;
+    auto& label = merge.GetResultNodeLabels().at(node);
+    const LeafSet* leafset = label.GetLeafSet();
+    if (leafset == nullptr or leafset->empty()) {
+      result[node.GetId().value] = LeafCladeHash(label.GetSampleId());
+      continue;
+    }
+    auto [it, inserted] = leafset_hashes.try_emplace(leafset, 0);
+    if (inserted) {
+      // the child clades of a node are disjoint
+      for (const auto& clade : leafset->GetClades()) {
+        for (UniqueData leaf : clade) {
+          it->second += LeafCladeHash(leaf);
         }
       }
     }
-    return true;
+    result[node.GetId().value] = it->second;
   }
-};
+  return result;
+}
 
 // Create a BinaryOperatorWeightOps for computing sum RF distances to the provided
 // reference DAG (using SimpleWeightOps):
@@ -104,44 +167,43 @@ struct SumRFDistance_ {
   using Weight = ArbitraryInt;
   static inline Weight Identity = 0;
   ArbitraryInt num_trees_in_dag;
-  std::map<std::set<std::string>, ArbitraryInt> leafset_to_full_treecount;
+  std::unordered_map<CladeHash, ArbitraryInt, CladeHashKey> leafset_to_full_treecount;
   ArbitraryInt shift_sum_;
 
  private:
   const Merge* reference_dag_;
   const Merge* compute_dag_;
+  // clade hashes of the compute DAG's nodes, indexed by node id
+  std::vector<CladeHash> compute_clade_hashes_;
 
  public:
   explicit SumRFDistance_(const Merge& reference_dag, const Merge& compute_dag)
       : reference_dag_{&reference_dag}, compute_dag_{&compute_dag} {
     SubtreeWeight<TreeCount, MergeDAG> below_tree_counts{reference_dag.GetResult()};
-    std::vector<ArbitraryInt> above_tree_counts;
-    above_tree_counts.resize(GetReferenceDAG().GetResult().GetNodesCount());
-    num_trees_in_dag = below_tree_counts.ComputeWeightBelow(
-        GetReferenceDAG().GetResult().GetRoot(), {});
+    std::vector<CheckedCount> above_tree_counts =
+        ComputeAboveTreeCounts(reference_dag.GetResult(), below_tree_counts);
+    auto reference_root = GetReferenceDAG().GetResult().GetRoot();
+    num_trees_in_dag =
+        below_tree_counts.ComputeWeightBelow(reference_root, {}).ToCppInt();
+    std::vector<CladeHash> reference_clade_hashes = ComputeCladeHashes(reference_dag);
 
     // create a list of unique (topologically) nodes in the DAG, and accumulate
     // above_tree_counts[n]*below_tree_counts[n] by adding over all n with identical
     // clade sets
     for (auto node : GetReferenceDAG().GetResult().GetNodes()) {
-      ComputeAboveTreeCount(node, above_tree_counts, below_tree_counts);
       if (not node.IsUA()) {
-        auto clade = [this, node] {
-          auto& label = GetReferenceDAG().GetResultNodeLabels().at(node);
-          std::set<std::string> leafs;
-          for (auto l : label.GetLeafSet()->ToParentClade(label.GetSampleId())) {
-            leafs.insert(l.ToString());
-          }
-          return leafs;
-        }();
-        leafset_to_full_treecount[clade] +=
-            above_tree_counts[node.GetId().value] *
-            below_tree_counts.ComputeWeightBelow(node, {});
+        leafset_to_full_treecount[reference_clade_hashes[node.GetId().value]] +=
+            (above_tree_counts[node.GetId().value] *
+             below_tree_counts.ComputeWeightBelow(node, {}))
+                .ToCppInt();
       }
     }
     // sum all of the values in leafset_to_full_treecount
     shift_sum_ = ranges::accumulate(leafset_to_full_treecount | ranges::views::values,
                                     ArbitraryInt{0});
+    compute_clade_hashes_ = &compute_dag == &reference_dag
+                                ? std::move(reference_clade_hashes)
+                                : ComputeCladeHashes(compute_dag);
   }
 
   template <typename DAG>
@@ -151,18 +213,8 @@ struct SumRFDistance_ {
 
   template <typename DAG>
   Weight ComputeEdge(DAG dag, EdgeId edge_id) const {
-    // clade should be a LeafSet, the key type in the mapping
-    // leafset_to_full_treecount:
-    auto clade = [this, dag, edge_id] {
-      auto edge = dag.Get(edge_id);
-      auto& label = GetComputeDAG().GetResultNodeLabels().at(edge.GetChild());
-      std::set<std::string> leafs;
-      for (auto l : label.GetLeafSet()->ToParentClade(label.GetSampleId())) {
-        leafs.insert(l.ToString());
-      }
-      return leafs;
-    }();
-    auto record = leafset_to_full_treecount.find(clade);
+    NodeId child = dag.Get(edge_id).GetChild();
+    auto record = leafset_to_full_treecount.find(compute_clade_hashes_.at(child.value));
     if (record == leafset_to_full_treecount.end()) {
       return num_trees_in_dag;
     } else {
@@ -202,6 +254,9 @@ struct MaxSumRFDistance_ : SumRFDistance_ {
   using Weight = typename SumRFDistance_::Weight;
   explicit MaxSumRFDistance_(const Merge& reference_dag, const Merge& compute_dag)
       : SumRFDistance_{reference_dag, compute_dag} {}
+  // reuse the reference DAG statistics of `sum_rf_distance`
+  explicit MaxSumRFDistance_(const SumRFDistance_& sum_rf_distance)
+      : SumRFDistance_{sum_rf_distance} {}
   bool Compare(Weight lhs, Weight rhs) const { return lhs > rhs; }
 };
 
@@ -209,6 +264,9 @@ struct MaxSumRFDistance : SimpleWeightOps<MaxSumRFDistance_> {
   explicit MaxSumRFDistance(const Merge& reference_dag, const Merge& compute_dag)
       : SimpleWeightOps<MaxSumRFDistance_>{
             MaxSumRFDistance_{reference_dag, compute_dag}} {}
+  explicit MaxSumRFDistance(const SumRFDistance& sum_rf_distance)
+      : SimpleWeightOps<MaxSumRFDistance_>{
+            MaxSumRFDistance_{sum_rf_distance.GetOps()}} {}
 };
 
 // Create a WeightOps for computing RF distances to the provided reference tree:
@@ -0,0 +1,34 @@
+/*
+Pairwise RF distances between many trees, e.g. trees sampled across iterations, to
+monitor convergence without building a DAG for every pair.
+
+Every tree's clades are encoded once as 128-bit clade hashes over the dense sample
+id index (see LeafCladeHash in rf_distance.hpp). The RF distance between two trees is
+the number of clades in exactly one of them, so the matrix only needs the number of
+clades shared by every pair. Distinct clades are grouped by the set of trees that
+contain them, and each group adds its size to the shared counts of the pairs of
+trees in it, so clades present in all trees cost one group in total.
+*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "larch/rf_distance.hpp"
+#include "larch/parallel/parallel_common.hpp"
+
+/**
+ * Distinct clade hashes of all the nodes of `tree` except the UA, sorted.
+ */
+template <typename DAG>
+std::vector<CladeHash> ComputeTreeCladeHashes(DAG tree);
+
+/**
+ * RF distances between all pairs of `trees`, as a symmetric matrix indexed by
+ * the positions of the trees in `trees`. Trees are compared as rooted trees, by
+ * the leaf sets below their nodes, like RFDistance.
+ */
+template <typename DAG>
+std::vector<std::vector<size_t>> ComputeRFDistanceMatrix(const std::vector<DAG>& trees);
+
+#include "larch/impl/rf_distance_matrix_impl.hpp"
@@ -0,0 +1,185 @@
+/**
+ * Kernels for walking two sorted arrays of unique 32-bit values, such as the
+ * mutation positions of two PackedMaps.
+ *
+ * With AVX2 (or SSE2) blocks of 8 (or 4) values from each side are compared
+ * all-against-all with vector rotations, and the block with the smaller last
+ * value is retired. Blocks that don't overlap are skipped with two scalar
+ * compares. The remainder, and builds without vector support, use a scalar
+ * two-pointer merge.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace SortedSetKernels {
+
+#if defined(__AVX2__)
+inline constexpr size_t Width = 8;
+#elif defined(__SSE2__)
+inline constexpr size_t Width = 4;
+#else
+inline constexpr size_t Width = 0;
+#endif
+
+/**
+ * Compare Width values at `lhs` with Width values at `rhs`. Returns a bit mask
+ * of the matched lhs lanes, and for each matched lane `l` stores the index of
+ * the equal rhs lane in rhs_lane[l].
+ */
+inline unsigned MatchBlocks([[maybe_unused]] const std::uint32_t* lhs,
+                            [[maybe_unused]] const std::uint32_t* rhs,
+                            [[maybe_unused]] std::uint8_t* rhs_lane) {
+  unsigned result = 0;
+#if defined(__AVX2__)
+  const __m256i lhs_vec = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs));
+  __m256i rhs_vec = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs));
+  const __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+  for (unsigned rotation = 0; rotation < Width; ++rotation) {
+    auto mask = static_cast<unsigned>(
+        _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(lhs_vec, rhs_vec))));
+    result |= mask;
+    for (; mask != 0; mask &= mask - 1) {
+      const auto lane = static_cast<unsigned>(__builtin_ctz(mask));
+      rhs_lane[lane] = static_cast<std::uint8_t>((lane + rotation) % Width);
+    }
+    rhs_vec = _mm256_permutevar8x32_epi32(rhs_vec, rotate);
+  }
+#elif defined(__SSE2__)
+  const __m128i lhs_vec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs));
+  __m128i rhs_vec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs));
+  for (unsigned rotation = 0; rotation < Width; ++rotation) {
+    auto mask = static_cast<unsigned>(
+        _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(lhs_vec, rhs_vec))));
+    result |= mask;
+    for (; mask != 0; mask &= mask - 1) {
+      const auto lane = static_cast<unsigned>(__builtin_ctz(mask));
+      rhs_lane[lane] = static_cast<std::uint8_t>((lane + rotation) % Width);
+    }
+    rhs_vec = _mm_shuffle_epi32(rhs_vec, _MM_SHUFFLE(0, 3, 2, 1));
+  }
+#endif
+  return result;
+}
+
+}  // namespace SortedSetKernels
+
+/**
+ * Classify the elements of two sorted arrays of unique values: calls
+ * lhs_only(i) for lhs[i] not in rhs, rhs_only(j) for rhs[j] not in lhs, and
+ * both(i, j) when lhs[i] == rhs[j]. Each callback sees its indices in
+ * increasing order, but calls to different callbacks are not interleaved by
+ * value.
+ */
+template <typename LhsOnly, typename RhsOnly, typename Both>
+inline void MergeSortedUnique(const std::uint32_t* lhs, size_t lhs_size,
+                              const std::uint32_t* rhs, size_t rhs_size,
+                              LhsOnly&& lhs_only, RhsOnly&& rhs_only, Both&& both) {
+  constexpr size_t Width = SortedSetKernels::Width;
+  size_t i = 0;
+  size_t j = 0;
+  // matched lanes of the current lhs and rhs blocks
+  unsigned lhs_found = 0;
+  unsigned rhs_found = 0;
+  if constexpr (Width > 0) {
+    std::uint8_t rhs_lane[Width > 0 ? Width : 1] = {};
+    while (i + Width <= lhs_size and j + Width <= rhs_size) {
+      const std::uint32_t lhs_last = lhs[i + Width - 1];
+      const std::uint32_t rhs_last = rhs[j + Width - 1];
+      if (not(lhs_last < rhs[j] or rhs_last < lhs[i])) {
+        unsigned matched = SortedSetKernels::MatchBlocks(lhs + i, rhs + j, rhs_lane);
+        lhs_found |= matched;
+        for (; matched != 0; matched &= matched - 1) {
+          const auto lane = static_cast<unsigned>(__builtin_ctz(matched));
+          rhs_found |= 1u << rhs_lane[lane];
+          both(i + lane, j + rhs_lane[lane]);
+        }
+      }
+      if (not(rhs_last < lhs_last)) {
+        for (size_t lane = 0; lane < Width; ++lane) {
+          if ((lhs_found & (1u << lane)) == 0) {
+            lhs_only(i + lane);
+          }
+        }
+        i += Width;
+        lhs_found = 0;
+      }
+      if (not(lhs_last < rhs_last)) {
+        for (size_t lane = 0; lane < Width; ++lane) {
+          if ((rhs_found & (1u << lane)) == 0) {
+            rhs_only(j + lane);
+          }
+        }
+        j += Width;
+        rhs_found = 0;
+      }
+    }
+  }
+
+  // Scalar merge of the remainder, skipping elements of the current blocks
+  // that were already matched.
+  const size_t lhs_block = i;
+  const size_t rhs_block = j;
+  auto lhs_matched = [&](size_t idx) {
+    return idx - lhs_block < Width and ((lhs_found >> (idx - lhs_block)) & 1u) != 0;
+  };
+  auto rhs_matched = [&](size_t idx) {
+    return idx - rhs_block < Width and ((rhs_found >> (idx - rhs_block)) & 1u) != 0;
+  };
+  while (i < lhs_size and j < rhs_size) {
+    if (lhs_matched(i)) {
+      ++i;
+    } else if (rhs_matched(j)) {
+      ++j;
+    } else if (lhs[i] < rhs[j]) {
+      lhs_only(i++);
+    } else if (rhs[j] < lhs[i]) {
+      rhs_only(j++);
+    } else {
+      both(i++, j++);
+    }
+  }
+  for (; i < lhs_size; ++i) {
+    if (not lhs_matched(i)) {
+      lhs_only(i);
+    }
+  }
+  for (; j < rhs_size; ++j) {
+    if (not rhs_matched(j)) {
+      rhs_only(j);
+    }
+  }
+}
+
+/**
+ * Reference implementation of MergeSortedUnique without vector instructions.
+ */
+template <typename LhsOnly, typename RhsOnly, typename Both>
+inline void MergeSortedUniqueScalar(const std::uint32_t* lhs, size_t lhs_size,
+                                    const std::uint32_t* rhs, size_t rhs_size,
+                                    LhsOnly&& lhs_only, RhsOnly&& rhs_only,
+                                    Both&& both) {
+  size_t i = 0;
+  size_t j = 0;
+  while (i < lhs_size and j < rhs_size) {
+    if (lhs[i] < rhs[j]) {
+      lhs_only(i++);
+    } else if (rhs[j] < lhs[i]) {
+      rhs_only(j++);
+    } else {
+      both(i++, j++);
+    }
+  }
+  for (; i < lhs_size; ++i) {
+    lhs_only(i);
+  }
+  for (; j < rhs_size; ++j) {
+    rhs_only(j);
+  }
+}
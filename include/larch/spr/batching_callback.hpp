@@ -107,13 +107,13 @@ class BatchingCallback : public Move_Found_Callback {
     return out;
   }
 
-  void SetSample(MAT::Tree& tree, std::string ref_seq) {
+  void SetSample(MAT::Tree& tree, std::string_view ref_seq) {
     sample_mat_tree_.delete_nodes();
     sample_mat_tree_ = CopyTree(tree);
-    sample_refseq_ = std::move(ref_seq);
+    sample_refseq_ = InternedSequence::Intern(ref_seq);
   }
   MAT::Tree sample_mat_tree_;
-  std::string sample_refseq_;
+  InternedSequence sample_refseq_;
 
   void CreateMATViewStorage(MAT::Tree& tree, std::string_view ref_seq);
 #else
@@ -0,0 +1,62 @@
+/**
+  FusedWeightOps combines several WeightOps into one, so that a single SubtreeWeight
+traversal computes all of them, loading each node's adjacency once.
+
+  The Weight of the fused ops is a tuple with one element per component WeightOps, a
+pair of the component's optimal weight and the number of subtrees achieving it. The
+count is the same as SubtreeWeight::MinWeightCount would give for the component, so
+components that don't report optimal indices, such as TreeCount, have a count of zero.
+
+  As the components generally disagree on optimal edges, WithinCladeAccumOptimum
+reports all edges as optimal, and the fused ops aren't meant for sampling or trimming.
+
+  This type is meant to be used as a parameter to SubtreeWeight, e.g.
+
+  SubtreeWeight<FusedWeightOps<BinaryParsimonyScore, MaxBinaryParsimonyScore>, MADAG>
+      scorer{dag};
+  auto [min_parsimony, max_parsimony] = scorer.ComputeWeightBelow(dag.GetRoot(), {});
+
+ */
+
+#pragma once
+
+#include <tuple>
+
+#include "larch/checked_count.hpp"
+#include "larch/madag/mutation_annotated_dag.hpp"
+
+template <typename... Ops>
+struct FusedWeightOps {
+  using Count = CheckedCount;
+  using Weight = std::tuple<std::pair<typename Ops::Weight, Count>...>;
+
+  FusedWeightOps() = default;
+
+  explicit FusedWeightOps(Ops... ops) : ops_{std::move(ops)...} {}
+
+  template <typename DAG>
+  Weight ComputeLeaf(DAG dag, NodeId node_id) const;
+
+  template <typename DAG>
+  Weight ComputeEdge(DAG dag, EdgeId edge_id) const;
+
+  inline std::pair<Weight, std::vector<size_t>> WithinCladeAccumOptimum(
+      const std::vector<Weight>& inweights) const;
+  inline Weight BetweenClades(const std::vector<Weight>& inweights) const;
+  inline Weight AboveNode(const Weight& edgeweight,
+                          const Weight& childnodeweight) const;
+
+  template <size_t I>
+  const auto& GetOps() const {
+    return std::get<I>(ops_);
+  }
+
+ private:
+  // Collect component I of each weight into a vector of the component's weights
+  template <size_t I>
+  static auto Component(const std::vector<Weight>& weights);
+
+  std::tuple<Ops...> ops_;
+};
+
+#include "larch/impl/subtree/fused_weight_ops_impl.hpp"
@@ -11,6 +11,8 @@
 
 struct ParsimonyScore {
   using Weight = size_t;
+  // BetweenClades is the sum of the weights
+  constexpr static bool AdditiveWeights = true;
 
   template <typename DAG>
   static Weight ComputeLeaf(DAG dag, NodeId node_id);
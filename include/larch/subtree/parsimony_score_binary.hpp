@@ -14,6 +14,8 @@ struct ParsimonyScore_ {
   using Weight = size_t;
   constexpr static Weight MaxWeight = std::numeric_limits<size_t>::max();
   constexpr static Weight Identity = 0;
+  // Combine is the sum of the weights
+  constexpr static bool AdditiveWeights = true;
   template <typename DAG>
   Weight ComputeLeaf(DAG dag, NodeId node_id) const;
   template <typename DAG>
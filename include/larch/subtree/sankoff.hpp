@@ -14,6 +14,7 @@
 #include <vector>
 
 #include "larch/madag/mutation_annotated_dag.hpp"
+#include "larch/subtree/sankoff_kernels.hpp"
 
 // 4x4 substitution cost matrix for a single site
 // Indexed by [parent_base][child_base] where base indices are A=0, C=1, G=2, T=3
@@ -37,7 +38,9 @@ inline std::vector<size_t> GetCompatibleIndices(MutationBase base);
 
 /**
  * DP table for Sankoff algorithm.
- * Stores costs and traceback information for variable sites only.
+ * Stores costs and traceback information for variable sites only. Per node and
+ * edge values are stored as base planes of all variable sites, so that the
+ * min-plus update of an edge runs over contiguous sites (see SankoffMinPlus).
  */
 struct SankoffDPTable {
   // Variable sites that need scoring (positions that have mutations)
@@ -46,14 +49,32 @@ struct SankoffDPTable {
   // Map from position to index in variable_sites
   std::unordered_map<size_t, size_t> site_to_index;
 
-  // DP costs: dp_costs[node_id][site_index] = SiteCosts (cost for each base)
-  std::vector<std::vector<SiteCosts>> dp_costs;
+  // DP costs: dp_costs[node_id][base * num_sites + site_index] = min cost to
+  // explain the subtree if the node has the given base
+  std::vector<std::vector<double>> dp_costs;
 
-  // Traceback: traceback[edge_id][site_index][parent_base] = optimal child base index
-  std::vector<std::vector<std::array<uint8_t, 4>>> traceback;
+  // Traceback: traceback[edge_id][parent_base * num_sites + site_index] = optimal
+  // child base index
+  std::vector<std::vector<uint8_t>> traceback;
 
   // Per-site cost matrices (indexed by site_index)
   std::vector<SiteCostMatrix> cost_matrices;
+
+  // cost_matrices as planes:
+  // cost_planes[(parent_base * 4 + child_base) * num_sites + site_index]
+  std::vector<double> cost_planes;
+
+  /**
+   * Costs of all bases at one site of a node.
+   */
+  SiteCosts GetSiteCosts(size_t node_idx, size_t site_index) const {
+    const size_t num_sites = variable_sites.size();
+    SiteCosts result;
+    for (size_t base = 0; base < 4; ++base) {
+      result[base] = dp_costs[node_idx][base * num_sites + site_index];
+    }
+    return result;
+  }
 };
 
 /**
@@ -0,0 +1,109 @@
+/**
+ * Min-plus kernel of the Sankoff DP, applied to one edge for all variable
+ * sites at once.
+ *
+ * Costs are stored as base planes: an array of `count` sites for every base
+ * (or for every parent and child base pair, for the cost matrices), so that
+ * consecutive sites are contiguous. With AVX2 blocks of 4 sites are processed
+ * in vector lanes, and the remainder, and builds without AVX2, use the scalar
+ * per-site loop. Both perform the same operations in the same order, so the
+ * results are identical.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace SankoffKernels {
+
+#if defined(__AVX2__)
+inline constexpr size_t Width = 4;
+#else
+inline constexpr size_t Width = 0;
+#endif
+
+/**
+ * The min-plus update of a single site, see SankoffMinPlus.
+ */
+inline void MinPlusSite(const double* costs, const double* child, double* parent,
+                        std::uint8_t* traceback, size_t count, size_t site) {
+  for (size_t parent_base = 0; parent_base < 4; ++parent_base) {
+    double best_cost = std::numeric_limits<double>::infinity();
+    std::uint8_t best_child_base = 0;
+    for (size_t child_base = 0; child_base < 4; ++child_base) {
+      const double cost = costs[(parent_base * 4 + child_base) * count + site] +
+                          child[child_base * count + site];
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_child_base = static_cast<std::uint8_t>(child_base);
+      }
+    }
+    traceback[parent_base * count + site] = best_child_base;
+    parent[parent_base * count + site] += best_cost;
+  }
+}
+
+}  // namespace SankoffKernels
+
+/**
+ * For every site s < count and parent base p, add the minimum over child bases
+ * c of costs[p * 4 + c][s] + child[c][s] to parent[p][s], and store the first c
+ * that attains it in traceback[p][s]. `child`, `parent` and `traceback` are 4
+ * planes of `count` sites, and `costs` is 16 planes indexed by p * 4 + c.
+ */
+inline void SankoffMinPlus(const double* costs, const double* child, double* parent,
+                           std::uint8_t* traceback, size_t count) {
+  size_t site = 0;
+#if defined(__AVX2__)
+  constexpr size_t Width = SankoffKernels::Width;
+  // picks the low byte of each of the 4 converted 32-bit lanes
+  const __m128i low_bytes =
+      _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+  for (; site + Width <= count; site += Width) {
+    __m256d child_costs[4];
+    for (size_t child_base = 0; child_base < 4; ++child_base) {
+      child_costs[child_base] = _mm256_loadu_pd(child + child_base * count + site);
+    }
+    for (size_t parent_base = 0; parent_base < 4; ++parent_base) {
+      __m256d best_cost = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+      __m256d best_child_base = _mm256_setzero_pd();
+      for (size_t child_base = 0; child_base < 4; ++child_base) {
+        const __m256d cost = _mm256_add_pd(
+            _mm256_loadu_pd(costs + (parent_base * 4 + child_base) * count + site),
+            child_costs[child_base]);
+        const __m256d less = _mm256_cmp_pd(cost, best_cost, _CMP_LT_OQ);
+        best_cost = _mm256_blendv_pd(best_cost, cost, less);
+        best_child_base = _mm256_blendv_pd(
+            best_child_base, _mm256_set1_pd(static_cast<double>(child_base)), less);
+      }
+      double* parent_costs = parent + parent_base * count + site;
+      _mm256_storeu_pd(parent_costs,
+                       _mm256_add_pd(_mm256_loadu_pd(parent_costs), best_cost));
+      const int packed = _mm_cvtsi128_si32(
+          _mm_shuffle_epi8(_mm256_cvtpd_epi32(best_child_base), low_bytes));
+      std::memcpy(traceback + parent_base * count + site, &packed, Width);
+    }
+  }
+#endif
+  for (; site < count; ++site) {
+    SankoffKernels::MinPlusSite(costs, child, parent, traceback, count, site);
+  }
+}
+
+/**
+ * Reference implementation of SankoffMinPlus without vector instructions.
+ */
+inline void SankoffMinPlusScalar(const double* costs, const double* child,
+                                 double* parent, std::uint8_t* traceback,
+                                 size_t count) {
+  for (size_t site = 0; site < count; ++site) {
+    SankoffKernels::MinPlusSite(costs, child, parent, traceback, count, site);
+  }
+}
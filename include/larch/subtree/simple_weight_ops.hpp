@@ -31,6 +31,9 @@ struct ExampleBinaryOperatorWeightOps {
 template <typename BinaryOperatorWeightOps>
 struct SimpleWeightOps {
   using Weight = typename BinaryOperatorWeightOps::Weight;
+  // BetweenClades folds Combine, so it's a sum if Combine is
+  constexpr static bool AdditiveWeights =
+      requires { requires BinaryOperatorWeightOps::AdditiveWeights; };
 
   SimpleWeightOps() = default;
 
@@ -32,10 +32,36 @@ struct ExampleWeightOps {
 #include <random>
 #include <boost/multiprecision/cpp_int.hpp>
 
+#include "larch/checked_count.hpp"
 #include "larch/madag/mutation_annotated_dag.hpp"
+#include "larch/parallel/parallel_common.hpp"
 
 using ArbitraryInt = boost::multiprecision::cpp_int;
 
+/**
+ * How SampleTrees picks an edge in each clade, matching SampleTree,
+ * UniformSampleTree, MinWeightSampleTree and MinWeightUniformSampleTree.
+ */
+enum class TreeSampling { Any, Uniform, MinWeight, MinWeightUniform };
+
+/**
+ * A tree of a DAG, as the sorted ids of the DAG edges it's made of.
+ */
+struct SampledTreeEdges {
+  std::vector<EdgeId> edges;
+  // number of draws that produced this tree
+  size_t count = 1;
+};
+
+/**
+ * A tree of a DAG and its weight, with the sorted ids of the tree's edges.
+ */
+template <typename Weight>
+struct WeightedTreeEdges {
+  Weight weight;
+  std::vector<EdgeId> edges;
+};
+
 template <typename Target>
 struct SampledDAGStorage;
 
@@ -62,15 +88,43 @@ class SubtreeWeight {
 
   DAG GetDAG() const;
 
+  /**
+   * Compute and cache the weights below `node`. Nodes are evaluated without
+   * recursion, children before parents, and the nodes whose children are all
+   * computed are evaluated concurrently, so ComputeLeaf, ComputeEdge and the
+   * aggregation functions of WeightOps must be safe to call from several
+   * threads. Each node aggregates its clades and edges in the same order as a
+   * sequential evaluation, so the cached results don't depend on scheduling.
+   */
   typename WeightOps::Weight ComputeWeightBelow(Node node, const WeightOps& weight_ops);
 
-  ArbitraryInt MinWeightCount(Node node, const WeightOps& weight_ops);
-
+  CheckedCount MinWeightCount(Node node, const WeightOps& weight_ops);
+
+  /**
+   * Drop the cached values of `updated_nodes` and of all their ancestors after
+   * the DAG changed below them, e.g. with Merge::GetUpdatedNodes() after
+   * merging more DAGs, which may repeat nodes. Nodes added to the DAG are
+   * accounted for as well. The next ComputeWeightBelow or MinWeightCount
+   * recomputes only the dropped nodes, all other cached values stay valid.
+   */
+  template <typename NodeIds>
+  void Update(const NodeIds& updated_nodes);
+
+  /**
+   * Copy the nodes and edges of the DAG that belong to minimum weight trees.
+   * Reachable nodes are marked in parallel and then copied in parallel into a
+   * storage sized up front, keeping compact genomes and edge mutations.
+   */
   [[nodiscard]] Storage TrimToMinWeight(const WeightOps& weight_ops);
 
   [[nodiscard]] SampledDAGStorage SampleTree(
       const WeightOps& weight_ops, std::optional<NodeId> below = std::nullopt);
 
+  /**
+   * Sample a tree uniformly among the trees below `below`. WeightOps is either
+   * TreeCount, which counts the trees exactly, or LogTreeCount, which gives
+   * the same distribution up to floating point error without big integers.
+   */
   [[nodiscard]] SampledDAGStorage UniformSampleTree(
       const WeightOps& weight_ops, std::optional<NodeId> below = std::nullopt);
 
@@ -80,11 +134,84 @@ class SubtreeWeight {
   [[nodiscard]] SampledDAGStorage MinWeightUniformSampleTree(
       const WeightOps& weight_ops, std::optional<NodeId> below = std::nullopt);
 
+  /**
+   * Draw `count` trees below `below` in parallel, without building their
+   * storages. The edge probabilities of each clade are computed once and shared
+   * by all draws, and every draw uses its own random stream seeded from `seed`
+   * and the draw's index, so the result doesn't depend on scheduling. With
+   * `deduplicate`, each distinct tree is returned once, in order of first draw,
+   * with the number of draws that produced it.
+   */
+  [[nodiscard]] std::vector<SampledTreeEdges> SampleTrees(
+      const WeightOps& weight_ops, TreeSampling sampling, size_t count, uint32_t seed,
+      bool deduplicate = false, std::optional<NodeId> below = std::nullopt);
+
+  /**
+   * Build the storage of a tree returned by SampleTrees with the same `below`.
+   */
+  [[nodiscard]] SampledDAGStorage MakeSampledTree(
+      const WeightOps& weight_ops, const SampledTreeEdges& tree,
+      std::optional<NodeId> below = std::nullopt);
+
+  /**
+   * The `count` trees below `below` (the root by default) with the lowest
+   * weights, lowest first. Weights are ordered by Compare for SimpleWeightOps
+   * and by operator< otherwise. Every node keeps the `count` lowest weight
+   * subtrees below each of its clades and below itself, built from those of
+   * its children, and nodes that don't depend on each other are processed in
+   * parallel. The result is exact when AboveNode and BetweenClades preserve
+   * the order of weights, as sums do.
+   */
+  [[nodiscard]] std::vector<WeightedTreeEdges<typename WeightOps::Weight>>
+  LowestWeightTrees(const WeightOps& weight_ops, size_t count,
+                    std::optional<NodeId> below = std::nullopt);
+
+  /**
+   * Call `callback` with every minimum weight tree below `below` (the root by
+   * default) exactly once, as the ids of the tree's edges in depth first order.
+   * Trees are enumerated without building them, by advancing the choices of
+   * minimum weight edges of the clades like an odometer, so consecutive trees
+   * cost time proportional to the edges that changed. The callback returns
+   * false to stop early. Returns the number of trees enumerated.
+   */
+  template <typename F>
+  size_t EnumerateMinWeightTrees(const WeightOps& weight_ops, F&& callback,
+                                 std::optional<NodeId> below = std::nullopt);
+
  private:
+  void ComputeWeightsBelow(Node node, const WeightOps& weight_ops);
+
+  // Call `func` on `node` and the nodes below it for which `is_done` is false,
+  // children before parents, calling it concurrently on nodes that don't
+  // depend on each other.
+  template <typename IsDone, typename F>
+  void ForEachBelowInWaves(Node node, IsDone&& is_done, F&& func);
+
+  // Reads the cached weights of the children of `clade`, which must be
+  // computed, and stores the optimal edges in `optimum_edgeids`.
   template <typename CladeRange>
   typename WeightOps::Weight CladeWeight(CladeRange&& clade,
+                                         const WeightOps& weight_ops,
+                                         std::vector<EdgeId>& optimum_edgeids);
+
+  static typename WeightOps::Weight CopyWeight(
+      const typename WeightOps::Weight& weight);
+
+  static bool IsLower(const WeightOps& weight_ops,
+                      const typename WeightOps::Weight& lhs,
+                      const typename WeightOps::Weight& rhs);
+
+  // Relative probabilities of picking each edge of `clade`, may be empty or all
+  // zero if the clade has no weight, in which case the first edge is picked.
+  template <typename CladeRange>
+  std::vector<double> CladeProbabilities(TreeSampling sampling, CladeRange&& clade,
                                          const WeightOps& weight_ops);
 
+  template <typename EdgeSelector>
+  [[nodiscard]] SampledDAGStorage BuildSampledTree(const WeightOps& weight_ops,
+                                                   const EdgeSelector& edge_selector,
+                                                   Node below);
+
   template <typename DistributionMaker>
   [[nodiscard]] SampledDAGStorage SampleTreeImpl(const WeightOps& weight_ops,
                                                  DistributionMaker&& distribution_maker,
@@ -95,22 +222,22 @@ class SubtreeWeight {
                    const WeightOps& weight_ops, const EdgeSelector& edge_selector,
                    MutableDAGType result);
 
-  template <typename NodeType, typename EdgesSelector, typename MutableDAGType>
-  void ExtractSubset(NodeType input_node, NodeId result_node_id,
-                     const WeightOps& weight_ops, const EdgesSelector& edge_selector,
-                     std::unordered_map<NodeId, NodeId>& mapped_id,
-                     MutableDAGType result);
-
   DAG dag_;
 
   // Indexed by NodeId.
   std::vector<std::optional<typename WeightOps::Weight>> cached_weights_;
-  std::vector<std::optional<ArbitraryInt>> cached_subtree_counts_;
+  std::vector<std::optional<CheckedCount>> cached_subtree_counts_;
 
   // outermost vector indexed by NodeId, next vector indexed by CladeIdx, innermost
   // vector records which EdgeIds achieve minimum in that clade.
   std::vector<std::vector<std::vector<EdgeId>>> cached_min_weight_edges_;
 
+  // Per node marks of the walks of Update and ForEachBelowInWaves, indexed by
+  // NodeId. Every entry is Unmarked between walks, which reset only the entries
+  // they touched, so a walk costs time proportional to the nodes it reaches.
+  static constexpr size_t Unmarked = std::numeric_limits<size_t>::max();
+  std::vector<size_t> node_marks_;
+
   std::random_device random_device_;
   std::mt19937 random_generator_;
 };
@@ -7,11 +7,11 @@
 
 #pragma once
 
-#include <boost/multiprecision/cpp_int.hpp>
+#include "larch/checked_count.hpp"
 #include "larch/madag/mutation_annotated_dag.hpp"
 
 struct TreeCount {
-  using Weight = boost::multiprecision::cpp_int;
+  using Weight = CheckedCount;
 
   template <typename DAG>
   static Weight ComputeLeaf(DAG dag, NodeId node_id);
@@ -33,4 +33,30 @@ struct TreeCount {
   inline static Weight AboveNode(const Weight& edgweight, Weight childnodeweight);
 };
 
+/**
+ * Counts (sub)trees like TreeCount, but as the natural logarithm of the count
+ * in a double, so that counts of any size are added and multiplied without
+ * big integers. Used for uniform sampling, where relative counts are all that
+ * matters.
+ */
+struct LogTreeCount {
+  using Weight = double;
+
+  template <typename DAG>
+  static Weight ComputeLeaf(DAG dag, NodeId node_id);
+
+  template <typename DAG>
+  static Weight ComputeEdge(DAG dag, EdgeId edge_id);
+  /*
+   * The log of the sum of the counts, with all indices
+   */
+  inline static std::pair<Weight, std::vector<size_t>> WithinCladeAccumOptimum(
+      const std::vector<Weight>&);
+  /*
+   * The log of the product of the counts
+   */
+  inline static Weight BetweenClades(const std::vector<Weight>&);
+  inline static Weight AboveNode(Weight edgweight, Weight childnodeweight);
+};
+
 #include "larch/impl/subtree/tree_count_impl.hpp"
@@ -37,22 +37,47 @@ one descendant edge.
 
 #pragma once
 
-#include <boost/multiprecision/cpp_int.hpp>
+#include <limits>
+#include <optional>
+#include <type_traits>
+
+#include "larch/checked_count.hpp"
 #include "larch/madag/mutation_annotated_dag.hpp"
 
-using Count = boost::multiprecision::cpp_int;
+using Count = CheckedCount;
 
+/**
+ * WeightOps with integer weights whose BetweenClades is their sum can declare
+ * `constexpr static bool AdditiveWeights = true;`, so that WeightCounter
+ * multiplies them by convolution over a dense array.
+ */
+template <typename WeightOps>
+constexpr bool HasAdditiveWeights =
+    std::is_integral_v<typename WeightOps::Weight> and
+    requires { requires WeightOps::AdditiveWeights; };
+
+/**
+ * A multiset of weights, as a map from each weight to its multiplicity. If
+ * `max_weights` is set, only that many lowest weights are kept, which is
+ * enough for the lowest weights of sums and products of counters, as long as
+ * BetweenClades is monotonic.
+ */
 template <typename WeightOps>
 class WeightCounter {
  public:
   WeightCounter(const WeightCounter<WeightOps>& other)
-      : weights_{other.weights_.Copy()}, weight_ops_{other.weight_ops_} {}
-  WeightCounter(const WeightOps& weight_ops);
+      : weights_{other.weights_.Copy()},
+        weight_ops_{other.weight_ops_},
+        max_weights_{other.max_weights_} {}
+  WeightCounter(const WeightOps& weight_ops,
+                std::optional<size_t> max_weights = std::nullopt);
   WeightCounter(WeightCounter&&) noexcept = default;
   WeightCounter(const std::vector<typename WeightOps::Weight>& weights,
-                const WeightOps& weight_ops);
+                const WeightOps& weight_ops,
+                std::optional<size_t> max_weights = std::nullopt);
   WeightCounter(ContiguousMap<typename WeightOps::Weight, Count>&& weights,
-                const WeightOps& weight_ops);
+                const WeightOps& weight_ops,
+                std::optional<size_t> max_weights = std::nullopt);
   ~WeightCounter() = default;
 
   /* A union of multisets */
@@ -66,10 +91,23 @@ class WeightCounter {
   bool operator!=(const WeightCounter<WeightOps>& rhs);
   const ContiguousMap<typename WeightOps::Weight, Count>& GetWeights() const;
   const WeightOps& GetWeightOps() const;
+  std::optional<size_t> GetMaxWeights() const;
+
+  /*
+   * Build a counter from weights in any order, adding up the counts of equal
+   * weights.
+   */
+  static WeightCounter FromUnsorted(
+      std::vector<std::pair<typename WeightOps::Weight, Count>>&& weights,
+      const WeightOps& weight_ops, std::optional<size_t> max_weights);
 
  private:
+  // the tighter of the two limits, for results of binary operations
+  std::optional<size_t> CombinedMaxWeights(const WeightCounter& rhs) const;
+
   ContiguousMap<typename WeightOps::Weight, Count> weights_;
   WeightOps weight_ops_;
+  std::optional<size_t> max_weights_;
 };
 
 template <typename WeightOps>
@@ -80,7 +118,11 @@ template <typename WeightOps>
 struct WeightAccumulator {
   using Weight = WeightCounter<WeightOps>;
   WeightAccumulator() = default;
-  WeightAccumulator(const WeightOps& ops);
+  /*
+   * With `max_weights`, count only the trees with that many lowest weights.
+   */
+  WeightAccumulator(const WeightOps& ops,
+                    std::optional<size_t> max_weights = std::nullopt);
 
   template <typename DAG>
   Weight ComputeLeaf(DAG dag, NodeId node_id) const;
@@ -104,6 +146,7 @@ struct WeightAccumulator {
 
  private:
   WeightOps weight_ops_ = {};
+  std::optional<size_t> max_weights_;
 };
 
 #include "larch/impl/subtree/weight_accumulator_impl.hpp"
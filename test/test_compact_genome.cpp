@@ -1,8 +1,14 @@
 #include "larch/madag/compact_genome.hpp"
+#include "larch/madag/delta_compact_genome.hpp"
+
+#include <random>
 
 #include "test_common.hpp"
+#include "larch/benchmark.hpp"
+#include "larch/sorted_set_kernels.hpp"
 #include "larch/dag_loader.hpp"
 #include "larch/madag/mutation_annotated_dag.hpp"
+#include "larch/merge/merge.hpp"
 
 [[maybe_unused]] static void test_edge_mutations(std::string_view path) {
   MADAGStorage dag_storage = LoadDAGFromProtobuf(path);
@@ -43,3 +49,404 @@
 [[maybe_unused]] static const auto test_added0 =
     add_test({[] { test_edge_mutations("data/test_5_trees/tree_0.pb.gz"); },
               "Compact genomes: test_5_trees"});
+
+static void test_packed_mutations() {
+  for (char base : {'A', 'C', 'G', 'T', 'N'}) {
+    TestAssert(MutationBase::FromNibble(MutationBase{base}.ToNibble()) == base);
+  }
+  TestAssert(MutationBase::FromNibble(MutationBase{'A', 'G'}.ToNibble()) ==
+             MutationBase('A', 'G'));
+
+  PackedMap<MutationPosition, MutationBase> packed;
+  ContiguousMap<MutationPosition, MutationBase> expected;
+  auto check = [&] {
+    TestAssert(packed.size() == expected.size());
+    TestAssert(ranges::equal(packed, expected));
+  };
+  for (size_t pos : {7, 3, 11, 1, 5, 9, 2}) {
+    MutationBase base = "ACGTN"[pos % 5];
+    packed.insert({{pos}, base});
+    expected.insert({{pos}, base});
+    check();
+  }
+  packed.insert_or_assign({5}, MutationBase{'G'});
+  expected.insert_or_assign({5}, MutationBase{'G'});
+  check();
+  packed.erase(packed.find({3}));
+  expected.erase(expected.find({3}));
+  check();
+  packed.erase(packed.begin());
+  expected.erase(expected.begin());
+  check();
+
+  PackedMap<MutationPosition, MutationBase> other;
+  other.push_back({4}, 'T');
+  other.push_back({5}, 'A');
+  packed.Union(other);
+  expected.insert({{4}, 'T'});
+  check();
+  TestAssert(packed.at({5}) == 'G');
+
+  EdgeMutations edge_mutations;
+  edge_mutations[{12}] = {'A', 'T'};
+  edge_mutations[{3}] = {'N', 'C'};
+  TestAssert(edge_mutations.size() == 2);
+  TestAssert(edge_mutations.GetMutation({3}).first == 'N');
+  TestAssert(edge_mutations.GetMutation({12}).second == 'T');
+  TestAssert(edge_mutations.begin()->first == MutationPosition{3});
+}
+
+static void test_packed_differing_sites() {
+  CompactGenome lhs{"ACGTACGT", "AAAAAAAA"};
+  CompactGenome rhs{"ACATAAGA", "AAAAAAAA"};
+  ContiguousSet<MutationPosition> expected;
+  for (size_t pos : {3, 6, 8}) {
+    expected.insert({pos});
+  }
+  TestAssert(lhs.DifferingSites(rhs) == expected);
+  TestAssert(rhs.DifferingSites(lhs) == expected);
+}
+
+[[maybe_unused]] static const auto test_added1 =
+    add_test({test_packed_mutations, "Compact genomes: packed mutations"});
+
+[[maybe_unused]] static const auto test_added2 =
+    add_test({test_packed_differing_sites, "Compact genomes: differing sites"});
+
+static void test_delta_compact_genomes(std::string_view path) {
+  MADAGStorage dag_storage = LoadDAGFromProtobuf(path);
+  MutableMADAG dag = dag_storage.View();
+  dag.RecomputeCompactGenomes(true);
+
+  for (size_t checkpoint_interval : {1, 3, 32}) {
+    auto delta_cgs = ComputeDeltaCompactGenomes(dag, checkpoint_interval);
+    for (auto node : dag.GetNodes()) {
+      const DeltaCompactGenome& delta_cg = delta_cgs.at(node.GetId());
+      const CompactGenome& cg = node.GetCompactGenome();
+      TestAssert(delta_cg.GetDepth() < checkpoint_interval);
+      TestAssert(delta_cg.ToCompactGenome() == cg);
+      TestAssert(ranges::equal(delta_cg, cg));
+      for (auto [pos, base] : cg) {
+        TestAssert(delta_cg[pos] == base);
+      }
+    }
+  }
+}
+
+[[maybe_unused]] static const auto test_added3 =
+    add_test({[] { test_delta_compact_genomes("data/test_5_trees/tree_0.pb.gz"); },
+              "Compact genomes: delta chains"});
+
+static void test_sorted_set_kernels() {
+  std::mt19937 random_generator{42};
+  for (size_t iteration = 0; iteration < 2000; ++iteration) {
+    const std::uint32_t range = 1 + random_generator() % 200;
+    std::vector<std::uint32_t> lhs, rhs;
+    for (size_t i = random_generator() % 40; i > 0; --i) {
+      lhs.push_back(random_generator() % range);
+    }
+    for (size_t i = random_generator() % 40; i > 0; --i) {
+      rhs.push_back(random_generator() % range);
+    }
+    lhs |= ranges::actions::sort | ranges::actions::unique;
+    rhs |= ranges::actions::sort | ranges::actions::unique;
+
+    std::vector<size_t> lhs_only, rhs_only, expected_lhs_only, expected_rhs_only;
+    std::vector<std::pair<size_t, size_t>> both, expected_both;
+    MergeSortedUnique(
+        lhs.data(), lhs.size(), rhs.data(), rhs.size(),
+        [&](size_t i) { lhs_only.push_back(i); },
+        [&](size_t j) { rhs_only.push_back(j); },
+        [&](size_t i, size_t j) { both.push_back({i, j}); });
+    MergeSortedUniqueScalar(
+        lhs.data(), lhs.size(), rhs.data(), rhs.size(),
+        [&](size_t i) { expected_lhs_only.push_back(i); },
+        [&](size_t j) { expected_rhs_only.push_back(j); },
+        [&](size_t i, size_t j) { expected_both.push_back({i, j}); });
+    TestAssert(lhs_only == expected_lhs_only);
+    TestAssert(rhs_only == expected_rhs_only);
+    TestAssert(both == expected_both);
+  }
+}
+
+static ContiguousSet<MutationPosition> differing_sites_reference(
+    const CompactGenome& lhs, const CompactGenome& rhs) {
+  ContiguousSet<MutationPosition> result;
+  for (auto [pos, base] : lhs) {
+    auto other = rhs[pos];
+    if (not other.has_value() or not other->IsCompatible(base)) {
+      result.insert(pos);
+    }
+  }
+  for (auto [pos, base] : rhs) {
+    auto other = lhs[pos];
+    if (not other.has_value() or not other->IsCompatible(base)) {
+      result.insert(pos);
+    }
+  }
+  return result;
+}
+
+static EdgeMutations edge_mutations_reference(std::string_view reference_sequence,
+                                              const CompactGenome& parent,
+                                              const CompactGenome& child) {
+  ContiguousSet<MutationPosition> positions;
+  for (auto [pos, base] : parent) {
+    positions.insert(pos);
+  }
+  for (auto [pos, base] : child) {
+    positions.insert(pos);
+  }
+  using Mutation = std::pair<MutationPosition, std::pair<MutationBase, MutationBase>>;
+  std::vector<Mutation> result;
+  for (auto pos : positions) {
+    MutationBase parent_base = parent.GetBase(pos, reference_sequence);
+    MutationBase child_base = child.GetBase(pos, reference_sequence);
+    if (not parent_base.IsCompatible(child_base)) {
+      result.push_back({pos, {parent_base, child_base.GetFirstBase()}});
+    }
+  }
+  return EdgeMutations{result};
+}
+
+static void bench_differing_sites(std::string_view path, std::string_view refseq_path) {
+  std::string reference_sequence = LoadReferenceSequence(refseq_path);
+  MADAGStorage dag_storage = LoadTreeFromProtobuf(path, reference_sequence);
+  MutableMADAG dag = dag_storage.View();
+  dag.RecomputeCompactGenomes(true);
+
+  std::vector<std::pair<NodeId, NodeId>> pairs;
+  for (auto edge : dag.GetEdges()) {
+    pairs.push_back({edge.GetParentId(), edge.GetChildId()});
+  }
+  auto leafs = dag.GetLeafs() | Transform::GetId() | ranges::to_vector;
+  leafs.resize(std::min<size_t>(leafs.size(), 300));
+  for (auto lhs : leafs) {
+    for (auto rhs : leafs) {
+      pairs.push_back({lhs, rhs});
+    }
+  }
+
+  for (auto [lhs, rhs] : pairs) {
+    const CompactGenome& lhs_cg = dag.Get(lhs).GetCompactGenome();
+    const CompactGenome& rhs_cg = dag.Get(rhs).GetCompactGenome();
+    TestAssert(lhs_cg.DifferingSites(rhs_cg) ==
+               differing_sites_reference(lhs_cg, rhs_cg));
+    TestAssert(CompactGenome::ToEdgeMutations(reference_sequence, lhs_cg, rhs_cg) ==
+               edge_mutations_reference(reference_sequence, lhs_cg, rhs_cg));
+  }
+
+  // time both merge kernels on the mutation positions of the same pairs
+  std::vector<std::vector<std::uint32_t>> positions(dag.GetNodesCount());
+  for (auto node : dag.GetNodes()) {
+    for (auto [pos, base] : node.GetCompactGenome()) {
+      positions.at(node.GetId().value).push_back(
+          static_cast<std::uint32_t>(pos.value));
+    }
+  }
+  auto time_kernel = [&](auto&& merge, size_t& classified) {
+    Benchmark time;
+    for (auto [lhs, rhs] : pairs) {
+      const auto& lhs_pos = positions.at(lhs.value);
+      const auto& rhs_pos = positions.at(rhs.value);
+      merge(
+          lhs_pos.data(), lhs_pos.size(), rhs_pos.data(), rhs_pos.size(),
+          [&](size_t i) { classified += i; }, [&](size_t j) { classified += j; },
+          [&](size_t i, size_t j) { classified += i ^ j; });
+    }
+    time.stop();
+    return time.durationMs();
+  };
+  size_t kernel_classified = 0;
+  size_t scalar_classified = 0;
+  auto kernel_ms = time_kernel(
+      [](auto&&... args) { MergeSortedUnique(std::forward<decltype(args)>(args)...); },
+      kernel_classified);
+  auto scalar_ms = time_kernel(
+      [](auto&&... args) {
+        MergeSortedUniqueScalar(std::forward<decltype(args)>(args)...);
+      },
+      scalar_classified);
+
+  TestAssert(kernel_classified == scalar_classified);
+  std::cout << pairs.size() << " pairs, scalar " << scalar_ms << " ms, vector width "
+            << SortedSetKernels::Width << " " << kernel_ms << " ms ";
+}
+
+[[maybe_unused]] static const auto test_added4 =
+    add_test({test_sorted_set_kernels, "Compact genomes: sorted set kernels"});
+
+[[maybe_unused]] static const auto test_added5 =
+    add_test({[] {
+                bench_differing_sites("data/seedtree/seedtree.pb.gz",
+                                      "data/seedtree/refseq.txt.gz");
+              },
+              "Compact genomes: differing sites benchmark",
+              {"slow"}});
+
+static void test_incremental_hash() {
+  std::vector<MADAGStorage<>> trees;
+  std::vector<MADAG> tree_views;
+  for (size_t i = 0; i < 5; ++i) {
+    trees.emplace_back(LoadDAGFromProtobuf("data/test_5_trees/tree_" +
+                                           std::to_string(i) + ".pb.gz"));
+  }
+  for (auto& tree : trees) {
+    tree.View().RecomputeCompactGenomes(true);
+    tree.View().SampleIdsFromCG(true);
+    tree_views.push_back(tree.View());
+  }
+  Merge merge{tree_views.front().GetReferenceSequence()};
+  merge.AddDAGs(tree_views);
+  MergeDAG result = merge.GetResult();
+  auto& deduplicated =
+      static_cast<const ExtraFeatureConstView<Deduplicate<CompactGenome>, MergeDAG>&>(
+          result);
+
+  const std::string& reference_sequence = tree_views.front().GetReferenceSequence();
+  for (auto tree : tree_views) {
+    for (auto node : tree.GetNodes()) {
+      // genomes built incrementally along edges hash like genomes built at once
+      const CompactGenome& incremental = node.GetCompactGenome();
+      CompactGenome full{incremental.ToSequence(reference_sequence),
+                         reference_sequence};
+      TestAssert(incremental == full);
+      TestAssert(incremental.Hash() == full.Hash());
+      if (not node.IsLeaf() and not full.empty()) {
+        TestAssert(deduplicated.FindDeduplicated(full) != nullptr);
+      }
+    }
+  }
+
+  CompactGenome changed = tree_views.front().GetRoot().GetFirstChild().GetChild()
+                              .GetCompactGenome()
+                              .Copy(static_cast<CompactGenome*>(nullptr));
+  ContiguousMap<MutationPosition, MutationBase> changes;
+  for (size_t pos = 1; pos <= 3; ++pos) {
+    char base = reference_sequence.at(pos - 1) == 'T' ? 'G' : 'T';
+    changes.insert({{pos}, base});
+  }
+  changed.ApplyChanges(changes);
+  CompactGenome expected{changed.ToSequence(reference_sequence), reference_sequence};
+  TestAssert(changed.Hash() == expected.Hash());
+}
+
+static void bench_recompute_compact_genomes(std::string_view path,
+                                            std::string_view refseq_path) {
+  std::string reference_sequence = LoadReferenceSequence(refseq_path);
+  MADAGStorage dag_storage = LoadTreeFromProtobuf(path, reference_sequence);
+  MutableMADAG dag = dag_storage.View();
+  constexpr size_t iterations = 20;
+  Benchmark bench;
+  for (size_t i = 0; i < iterations; ++i) {
+    dag.RecomputeCompactGenomes(true);
+  }
+  bench.stop();
+  std::cout << dag.GetNodesCount() * iterations * 1000 /
+                   std::max<size_t>(1, static_cast<size_t>(bench.durationMs()))
+            << " nodes/s ";
+}
+
+[[maybe_unused]] static const auto test_added6 =
+    add_test({test_incremental_hash, "Compact genomes: incremental hash"});
+
+[[maybe_unused]] static const auto test_added7 =
+    add_test({[] {
+                bench_recompute_compact_genomes("data/seedtree/seedtree.pb.gz",
+                                                "data/seedtree/refseq.txt.gz");
+              },
+              "Compact genomes: recompute benchmark",
+              {"slow"}});
+
+static void test_recompute_deep_tree() {
+  // caterpillar tree: internal node k has a leaf child n + k and the next
+  // internal node as children, so the tree is n levels deep
+  constexpr size_t n = 100000;
+  const std::string reference_sequence = "ACGT";
+  MADAGStorage<> dag_storage = MADAGStorage<>::EmptyDefault();
+  auto dag = dag_storage.View();
+  dag.SetReferenceSequence(reference_sequence);
+  dag.InitializeNodes(2 * n + 2);
+  const NodeId ua{2 * n + 1};
+
+  auto next_base = [](char base) {
+    switch (base) {
+      case 'A':
+        return 'C';
+      case 'C':
+        return 'G';
+      case 'G':
+        return 'T';
+      default:
+        return 'A';
+    }
+  };
+  std::vector<std::string> expected;
+  std::string sequence = reference_sequence;
+  size_t edge_id = 0;
+  dag.AddEdge({edge_id++}, ua, {0}, {0});
+  for (size_t k = 0; k < n; ++k) {
+    expected.push_back(sequence);
+    dag.AddEdge({edge_id++}, {k}, {n + k}, {0});
+    const NodeId next = k + 1 < n ? NodeId{k + 1} : NodeId{2 * n};
+    auto edge = dag.AddEdge({edge_id++}, {k}, next, {1});
+    const size_t pos = k % sequence.size();
+    const char base = next_base(sequence.at(pos));
+    edge.GetMutableEdgeMutations()[{pos + 1}] = {sequence.at(pos), base};
+    sequence.at(pos) = base;
+  }
+  dag.BuildConnections();
+  dag.RecomputeCompactGenomes(true);
+
+  for (size_t k = 0; k < n; ++k) {
+    TestAssert(dag.Get(NodeId{k}).GetCompactGenome().ToSequence(reference_sequence) ==
+               expected.at(k));
+    TestAssert(dag.Get(NodeId{n + k}).GetCompactGenome() ==
+               dag.Get(NodeId{k}).GetCompactGenome());
+  }
+  TestAssert(dag.Get(NodeId{2 * n}).GetCompactGenome().ToSequence(
+                 reference_sequence) == sequence);
+  TestAssert(dag.Get(ua).GetCompactGenome().empty());
+}
+
+[[maybe_unused]] static const auto test_added8 =
+    add_test({test_recompute_deep_tree, "Compact genomes: recompute deep tree"});
+
+static void test_packed_bases() {
+  const std::string_view letters = "ACGTN";
+  for (char base : letters) {
+    TestAssert(MutationBase{base}.ToChar() == base);
+  }
+  TestAssert(MutationBase{'A', 'G'}.ToChar() == 'N');
+
+  // compare the batch operations against the scalar ones on all lengths that
+  // cover a partial last word
+  std::mt19937 random_generator{0};
+  for (size_t count = 0; count < 70; ++count) {
+    PackedMap<MutationPosition, MutationBase> lhs, rhs;
+    EdgeMutations pairs;
+    size_t ambiguous = 0;
+    size_t leaf_mutations = 0;
+    bool compatible = true;
+    for (size_t pos = 1; pos <= count; ++pos) {
+      MutationBase parent = letters[random_generator() % letters.size()];
+      MutationBase child = letters[random_generator() % letters.size()];
+      lhs.push_back({pos}, parent);
+      rhs.push_back({pos}, child);
+      pairs[{pos}] = {parent, child};
+      ambiguous += parent.IsAmbiguous() ? 1 : 0;
+      leaf_mutations += (not child.IsAmbiguous() or parent.IsAmbiguous()) ? 1 : 0;
+      compatible = compatible and parent.IsCompatible(child);
+    }
+    TestAssert(PackedBases::CountAmbiguous(lhs.GetPackedValues().data(), count) ==
+               ambiguous);
+    TestAssert(PackedBases::AllCompatible(lhs.GetPackedValues().data(),
+                                          rhs.GetPackedValues().data(),
+                                          count) == compatible);
+    TestAssert(PackedBases::CountLeafMutations(pairs.GetPackedBases().data(), count) ==
+               leaf_mutations);
+  }
+}
+
+[[maybe_unused]] static const auto test_added9 =
+    add_test({test_packed_bases, "Compact genomes: packed bases batch operations"});
@@ -1,6 +1,7 @@
 #include "larch/subtree/subtree_weight.hpp"
 #include "larch/subtree/tree_count.hpp"
 
+#include <cmath>
 #include <iostream>
 #include <string_view>
 #include <string>
@@ -30,3 +31,50 @@ static void test_tree_count(std::string_view path, TreeCount::Weight expected_sc
 [[maybe_unused]] static const auto test_added1 =
     add_test({[] { test_tree_count("data/testcase1/full_dag.pb.gz", 7); },
               "Subtree weight: testcase1"});
+
+static void test_checked_count() {
+  using Big = CheckedCount::Big;
+  // products of small counts promote to cpp_int once they overflow 128 bits,
+  // and agree with cpp_int arithmetic on both sides of the boundary
+  CheckedCount count = 1;
+  Big expected = 1;
+  for (size_t i = 0; i < 40; ++i) {
+    count *= 12345;
+    expected *= 12345;
+    count += i;
+    expected += i;
+    TestAssert(count.ToCppInt() == expected);
+    TestAssert(count.ToString() == expected.str());
+    TestAssert(count.IsSmall() == (expected >> 128 == 0));
+  }
+  TestAssert(not count.IsSmall());
+  TestAssert(count > CheckedCount{~std::uint64_t{0}});
+  TestAssert(CheckedCount{expected} == count);
+
+  // dividing a promoted count back into range stores it unpromoted
+  CheckedCount quotient = count / count;
+  TestAssert(quotient.IsSmall());
+  TestAssert(quotient == 1);
+  TestAssert(CheckedCount{Big{7}}.IsSmall());
+
+  // fractions of counts too large for a double
+  TestAssert(std::abs((count * 2).Fraction(count * 5) - 0.4) < 1e-12);
+  TestAssert(CheckedCount{3}.Fraction(4) == 0.75);
+}
+
+static void test_log_tree_count(std::string_view path) {
+  MADAGStorage dag = LoadDAGFromProtobuf(path);
+  SubtreeWeight<TreeCount, MADAG> tree_count{dag.View()};
+  SubtreeWeight<LogTreeCount, MADAG> log_tree_count{dag.View()};
+  auto count = tree_count.ComputeWeightBelow(dag.View().GetRoot(), {});
+  const double expected = std::log(static_cast<double>(count));
+  const double log_count = log_tree_count.ComputeWeightBelow(dag.View().GetRoot(), {});
+  TestAssert(std::abs(log_count - expected) < 1e-9);
+}
+
+[[maybe_unused]] static const auto test_added2 =
+    add_test({test_checked_count, "Subtree weight: checked count"});
+
+[[maybe_unused]] static const auto test_added3 =
+    add_test({[] { test_log_tree_count("data/testcase/full_dag.pb.gz"); },
+              "Subtree weight: log tree count"});
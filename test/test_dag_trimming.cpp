@@ -1,5 +1,6 @@
 #include "larch/subtree/subtree_weight.hpp"
 #include "larch/subtree/parsimony_score_binary.hpp"
+#include "larch/subtree/tree_count.hpp"
 
 #include <iostream>
 #include <string_view>
@@ -15,6 +16,14 @@ static void test_dag_trimming(MADAG dag, size_t expected_edges) {
   MADAGStorage trimmed = weight.TrimToMinWeight({});
 
   TestAssert(trimmed.View().GetEdgesCount() == expected_edges);
+
+  // every tree of the trimmed DAG is a minimum weight tree of the input
+  SubtreeWeight<BinaryParsimonyScore, MADAG> trimmed_weight{trimmed.View()};
+  TestAssert(trimmed_weight.ComputeWeightBelow(trimmed.View().GetRoot(), {}) ==
+             weight.ComputeWeightBelow(dag.GetRoot(), {}));
+  SubtreeWeight<TreeCount, MADAG> trimmed_count{trimmed.View()};
+  TestAssert(trimmed_count.ComputeWeightBelow(trimmed.View().GetRoot(), {}) ==
+             weight.MinWeightCount(dag.GetRoot(), {}));
 }
 
 static void test_dag_trimming(std::string_view path, size_t expected_edges) {
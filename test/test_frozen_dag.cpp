@@ -0,0 +1,93 @@
+#include "larch/madag/frozen_dag.hpp"
+#include "larch/merge/merge.hpp"
+#include "larch/rf_distance.hpp"
+#include "larch/subtree/subtree_weight.hpp"
+#include "larch/subtree/tree_count.hpp"
+#include "larch/subtree/parsimony_score_binary.hpp"
+
+#include <string_view>
+#include <vector>
+
+#include "test_common.hpp"
+
+#include "larch/dag_loader.hpp"
+
+template <typename DAG>
+static void test_same_topology(DAG dag, FrozenDAG frozen) {
+  TestAssert(frozen.GetNodesCount() == dag.GetNodesCount());
+  TestAssert(frozen.GetEdgesCount() == dag.GetEdgesCount());
+  TestAssert(frozen.GetRoot().GetId() == dag.GetRoot().GetId());
+  TestAssert(frozen.GetLeafsCount() == dag.GetLeafsCount());
+  for (auto node : dag.GetNodes()) {
+    auto frozen_node = frozen.Get(node.GetId());
+    TestAssert(frozen_node.GetParentsCount() == node.GetParentsCount());
+    TestAssert(frozen_node.GetCladesCount() == node.GetCladesCount());
+    TestAssert(ranges::equal(frozen_node.GetChildren() | Transform::GetId(),
+                             node.GetChildren() | Transform::GetId()));
+    TestAssert(frozen_node.GetCompactGenome() == node.GetCompactGenome());
+    TestAssert(frozen_node.GetSampleId() == node.GetSampleId());
+  }
+  for (auto edge : dag.GetEdges()) {
+    auto frozen_edge = frozen.Get(edge.GetId());
+    TestAssert(frozen_edge.GetParentId() == edge.GetParentId());
+    TestAssert(frozen_edge.GetChildId() == edge.GetChildId());
+    TestAssert(frozen_edge.GetClade() == edge.GetClade());
+    TestAssert(frozen_edge.GetEdgeMutations() == edge.GetEdgeMutations());
+  }
+}
+
+static void test_frozen_madag(std::string_view path, TreeCount::Weight expected_count) {
+  MADAGStorage dag_storage = LoadDAGFromProtobuf(path);
+  MADAG dag = dag_storage.View();
+  FrozenDAGStorage frozen_storage = FreezeDAG(dag);
+  FrozenDAG frozen = frozen_storage.View();
+  frozen.GetRoot().Validate(true, true);
+  test_same_topology(dag, frozen);
+
+  SubtreeWeight<TreeCount, FrozenDAG> tree_count{frozen};
+  TestAssert(tree_count.ComputeWeightBelow(frozen.GetRoot(), {}) == expected_count);
+
+  SubtreeWeight<BinaryParsimonyScore, MADAG> parsimony{dag};
+  SubtreeWeight<BinaryParsimonyScore, FrozenDAG> frozen_parsimony{frozen};
+  TestAssert(parsimony.ComputeWeightBelow(dag.GetRoot(), {}) ==
+             frozen_parsimony.ComputeWeightBelow(frozen.GetRoot(), {}));
+  TestAssert(parsimony.MinWeightCount(dag.GetRoot(), {}) ==
+             frozen_parsimony.MinWeightCount(frozen.GetRoot(), {}));
+}
+
+static void test_frozen_merge() {
+  std::vector<MADAGStorage<>> trees;
+  std::vector<MADAG> tree_views;
+  for (size_t i = 0; i < 5; ++i) {
+    trees.emplace_back(LoadDAGFromProtobuf("data/test_5_trees/tree_" +
+                                           std::to_string(i) + ".pb.gz"));
+  }
+  for (auto& tree : trees) {
+    tree.View().RecomputeCompactGenomes(true);
+    tree.View().SampleIdsFromCG(true);
+    tree_views.push_back(tree.View());
+  }
+  Merge merge{tree_views.front().GetReferenceSequence()};
+  merge.AddDAGs(tree_views);
+
+  FrozenDAGStorage frozen_storage = FreezeDAG(merge.GetResult());
+  FrozenDAG frozen = frozen_storage.View();
+  test_same_topology(merge.GetResult(), frozen);
+
+  SubtreeWeight<SumRFDistance, MergeDAG> rf{merge.GetResult()};
+  SubtreeWeight<SumRFDistance, FrozenDAG> frozen_rf{frozen};
+  TestAssert(
+      rf.ComputeWeightBelow(merge.GetResult().GetRoot(), SumRFDistance{merge, merge}) ==
+      frozen_rf.ComputeWeightBelow(frozen.GetRoot(), SumRFDistance{merge, merge}));
+}
+
+[[maybe_unused]] static const auto test_added0 =
+    add_test({[] { test_frozen_madag("data/testcase/full_dag.pb.gz", 818); },
+              "Frozen DAG: testcase"});
+
+[[maybe_unused]] static const auto test_added1 =
+    add_test({[] { test_frozen_madag("data/testcase1/full_dag.pb.gz", 7); },
+              "Frozen DAG: testcase1"});
+
+[[maybe_unused]] static const auto test_added2 =
+    add_test({test_frozen_merge, "Frozen DAG: merge result"});
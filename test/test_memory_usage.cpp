@@ -0,0 +1,52 @@
+#include "larch/merge/merge.hpp"
+#include "larch/memory_usage.hpp"
+
+#include <string_view>
+#include <vector>
+
+#include "test_common.hpp"
+
+#include "larch/dag_loader.hpp"
+
+static void test_memory_usage_madag(std::string_view path) {
+  MADAGStorage dag_storage = LoadDAGFromProtobuf(path);
+  dag_storage.View().RecomputeCompactGenomes(true);
+  MemoryUsageReport report = dag_storage.MemoryUsage();
+  auto& entries = report.GetEntries();
+  TestAssert(entries.at("nodes/CompactGenome") > 0);
+  TestAssert(entries.at("nodes/DAGNeighbors") > 0);
+  TestAssert(entries.at("edges/EdgeMutations") > 0);
+  TestAssert(entries.at("edges/DAGEndpoints") > 0);
+  TestAssert(entries.at("dag/ReferenceSequence") >=
+             dag_storage.View().GetReferenceSequence().size());
+  TestAssert(report.Total() > entries.at("nodes/CompactGenome"));
+}
+
+static void test_memory_usage_merge() {
+  std::vector<MADAGStorage<>> trees;
+  std::vector<MADAG> tree_views;
+  for (size_t i = 0; i < 5; ++i) {
+    trees.emplace_back(LoadDAGFromProtobuf("data/test_5_trees/tree_" +
+                                           std::to_string(i) + ".pb.gz"));
+  }
+  for (auto& tree : trees) {
+    tree.View().RecomputeCompactGenomes(true);
+    tree.View().SampleIdsFromCG(true);
+    tree_views.push_back(tree.View());
+  }
+  Merge merge{tree_views.front().GetReferenceSequence()};
+  MemoryUsageReport empty = merge.MemoryUsage();
+  merge.AddDAGs(tree_views);
+  MemoryUsageReport report = merge.MemoryUsage();
+  TestAssert(report.Total() > empty.Total());
+  TestAssert(report.GetEntries().at("all_leaf_sets") >
+             empty.GetEntries().at("all_leaf_sets"));
+  TestAssert(report.GetEntries().at("result_dag/edges/EdgeMutations") > 0);
+}
+
+[[maybe_unused]] static const auto test_added0 =
+    add_test({[] { test_memory_usage_madag("data/testcase/full_dag.pb.gz"); },
+              "Memory usage: MADAG"});
+
+[[maybe_unused]] static const auto test_added1 =
+    add_test({test_memory_usage_merge, "Memory usage: merge"});
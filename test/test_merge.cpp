@@ -226,3 +226,38 @@ static void test_subtree() {
 
 [[maybe_unused]] static const auto test5_added =
     add_test({test_subtree, "Merge: Subtree"});
+
+static void test_shared_reference_sequence() {
+  std::vector<MADAGStorage<>> trees;
+  std::vector<MADAG> tree_views;
+  for (size_t i = 0; i < 5; ++i) {
+    trees.push_back(
+        LoadDAGFromProtobuf("data/test_5_trees/tree_" + std::to_string(i) + ".pb.gz"));
+    trees.back().View().RecomputeCompactGenomes(true);
+    trees.back().View().SampleIdsFromCG(true);
+  }
+  for (auto& tree : trees) {
+    tree_views.push_back(tree.View());
+  }
+
+  // equal reference sequences loaded separately share a single copy
+  const InternedSequence& reference_sequence =
+      tree_views.front().GetInternedReferenceSequence();
+  for (auto tree : tree_views) {
+    TestAssert(tree.GetInternedReferenceSequence() == reference_sequence);
+    TestAssert(&tree.GetReferenceSequence() ==
+               &tree_views.front().GetReferenceSequence());
+  }
+
+  Merge merge{tree_views.front().GetReferenceSequence()};
+  merge.AddDAGs(tree_views);
+  TestAssert(merge.GetResult().GetInternedReferenceSequence() == reference_sequence);
+  TestAssert(reference_sequence.use_count() >= 6);
+
+  MADAGStorage<> other = MADAGStorage<>::EmptyDefault();
+  other.View().SetReferenceSequence(reference_sequence.get() + "A");
+  TestAssert(other.View().GetInternedReferenceSequence() != reference_sequence);
+}
+
+[[maybe_unused]] static const auto test6_added =
+    add_test({test_shared_reference_sequence, "Merge: Shared reference sequence"});
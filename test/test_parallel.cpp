@@ -3,8 +3,11 @@
 #include "larch/parallel/parallel_common.hpp"
 #include "larch/parallel/reduction.hpp"
 
+#include <algorithm>
 #include <atomic>
+#include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 [[maybe_unused]] static void test_parallel_for() {
@@ -124,3 +127,40 @@
     add_test({test_parallel_actual_build_connections,
               "Parallel: actual BuildConnections",
               {"parallel"}});
+
+[[maybe_unused]] static void test_parallel_sample_ids() {
+  const size_t distinct = 5000;
+  const size_t first_index = SampleId::GetIndexCount();
+  std::vector<size_t> workers(4 * std::thread::hardware_concurrency());
+  std::iota(workers.begin(), workers.end(), 0);
+  std::vector<std::vector<std::pair<std::string, size_t>>> seen(workers.size());
+
+  ParallelForEach(workers, [&](size_t worker) {
+    for (size_t i = 0; i < distinct; ++i) {
+      std::string name =
+          "parallel_sample_" + std::to_string((i * 7 + worker) % distinct);
+      SampleId id = SampleId::Make(name);
+      seen.at(worker).emplace_back(std::move(name), id.GetIndex());
+    }
+  });
+
+  // every name gets exactly one index, and the new indices are dense
+  std::unordered_map<std::string, size_t> indices;
+  for (auto& worker_seen : seen) {
+    for (auto& [name, index] : worker_seen) {
+      TestAssert(indices.insert({name, index}).first->second == index);
+    }
+  }
+  TestAssert(indices.size() == distinct);
+  std::vector<bool> used(distinct, false);
+  for (auto& [name, index] : indices) {
+    TestAssert(index >= first_index and index < first_index + distinct);
+    used.at(index - first_index) = true;
+  }
+  TestAssert(std::all_of(used.begin(), used.end(), [](bool x) { return x; }));
+  TestAssert(SampleId::GetIndexCount() == first_index + distinct);
+  TestAssert(SampleId{}.GetIndex() == NoId);
+}
+
+[[maybe_unused]] static const auto test_added4 =
+    add_test({test_parallel_sample_ids, "Parallel: sample id interning", {"parallel"}});
@@ -1,4 +1,11 @@
 #include "larch/rf_distance.hpp"
+#include "larch/rf_distance_matrix.hpp"
+
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
 
 #include "test_common.hpp"
 #include "test_common_dag.hpp"
@@ -329,6 +336,135 @@ static void test_rf_distance_different_weight_ops() {
   }
 }
 
+static void test_clade_hashes(std::string_view path) {
+  MADAGStorage dag_storage = LoadDAGFromProtobuf(path);
+  dag_storage.View().RecomputeCompactGenomes(true);
+  dag_storage.View().SampleIdsFromCG(true);
+  MADAG dag = dag_storage.View();
+  Merge merge1(dag.GetReferenceSequence());
+  merge1.AddDAGs(std::vector{dag});
+  Merge merge2(dag.GetReferenceSequence());
+  merge2.AddDAGs(std::vector{dag});
+
+  // equal leaf sets have equal hashes in both merges, and distinct ones don't
+  // collide
+  std::map<std::set<std::string>, CladeHash> hashes;
+  std::map<CladeHash, std::set<std::string>> leafsets;
+  for (const Merge* merge : {&merge1, &merge2}) {
+    std::vector<CladeHash> clade_hashes = ComputeCladeHashes(*merge);
+    for (auto node : merge->GetResult().GetNodes()) {
+      if (node.IsUA()) {
+        continue;
+      }
+      auto& label = merge->GetResultNodeLabels().at(node);
+      std::set<std::string> leafs;
+      for (auto leaf : label.GetLeafSet()->ToParentClade(label.GetSampleId())) {
+        leafs.insert(leaf.ToString());
+      }
+      CladeHash hash = clade_hashes.at(node.GetId().value);
+      TestAssert(hashes.try_emplace(leafs, hash).first->second == hash);
+      TestAssert(leafsets.try_emplace(hash, leafs).first->second == leafs);
+    }
+  }
+  TestAssert(hashes.size() > 1);
+}
+
+// The number of trees above `node` by its definition, summing over the parent
+// edges the trees above the parent times the subtrees below its other clades.
+static ArbitraryInt reference_above_tree_count(
+    MergeDAG::NodeView node, SubtreeWeight<TreeCount, MergeDAG>& below,
+    std::vector<std::optional<ArbitraryInt>>& memo) {
+  auto& cached = memo.at(node.GetId().value);
+  if (cached.has_value()) {
+    return cached.value();
+  }
+  ArbitraryInt above = node.IsUA() ? 1 : 0;
+  for (auto parent_edge : node.GetParents()) {
+    auto parent = parent_edge.GetParent();
+    ArbitraryInt below_parent = 1;
+    for (size_t clade = 0; clade < parent.GetCladesCount(); ++clade) {
+      if (clade == parent_edge.GetClade().value) {
+        continue;
+      }
+      ArbitraryInt below_clade = 0;
+      for (auto edge : parent.GetClade({clade})) {
+        below_clade += below.ComputeWeightBelow(edge.GetChild(), {}).ToCppInt();
+      }
+      below_parent *= below_clade;
+    }
+    above += reference_above_tree_count(parent, below, memo) * below_parent;
+  }
+  cached = above;
+  return above;
+}
+
+static void check_above_tree_counts(const Merge& merge) {
+  auto dag = merge.GetResult();
+  SubtreeWeight<TreeCount, MergeDAG> below{dag};
+  auto above = ComputeAboveTreeCounts(dag, below);
+  TestAssert(above.size() == dag.GetNodesCount());
+  std::vector<std::optional<ArbitraryInt>> memo(dag.GetNodesCount());
+  for (auto node : dag.GetNodes()) {
+    TestAssert(above.at(node.GetId().value).ToCppInt() ==
+               reference_above_tree_count(node, below, memo));
+  }
+}
+
+static void test_above_tree_counts(std::string_view path) {
+  MADAGStorage dag_storage = LoadDAGFromProtobuf(path);
+  dag_storage.View().RecomputeCompactGenomes(true);
+  dag_storage.View().SampleIdsFromCG(true);
+  MADAG dag = dag_storage.View();
+  Merge merge(dag.GetReferenceSequence());
+  merge.AddDAGs(std::vector{dag});
+  check_above_tree_counts(merge);
+}
+
+static void test_above_tree_counts_multi_clade() {
+  auto dag1_storage = make_sample_dag();
+  auto dag2_storage = make_nonintersecting_sample_dag();
+  auto dag3_storage = make_sample_dag_with_one_unique_node();
+  auto dag1 = dag1_storage.View();
+  Merge merge(dag1.GetReferenceSequence());
+  merge.AddDAGs(std::vector{dag1, dag2_storage.View(), dag3_storage.View()});
+  // nodes with more than two clades, and nodes with several parents
+  TestAssert(ranges::any_of(merge.GetResult().GetNodes(),
+                            [](auto node) { return node.GetCladesCount() > 2; }));
+  TestAssert(ranges::any_of(merge.GetResult().GetNodes(),
+                            [](auto node) { return node.GetParentsCount() > 1; }));
+  check_above_tree_counts(merge);
+}
+
+static void test_rf_distance_matrix() {
+  std::vector<MADAGStorage<>> trees;
+  std::vector<MADAG> tree_views;
+  for (size_t i = 0; i < 5; ++i) {
+    trees.emplace_back(LoadDAGFromProtobuf("data/test_5_trees/tree_" +
+                                           std::to_string(i) + ".pb.gz"));
+  }
+  std::vector<Merge> merges;
+  merges.reserve(trees.size());
+  for (auto& tree : trees) {
+    tree.View().RecomputeCompactGenomes(true);
+    tree.View().SampleIdsFromCG(true);
+    tree_views.push_back(tree.View());
+    merges.emplace_back(tree.View().GetReferenceSequence());
+    merges.back().AddDAGs(std::vector{tree.View()});
+  }
+
+  auto matrix = ComputeRFDistanceMatrix(tree_views);
+  TestAssert(matrix.size() == trees.size());
+  for (size_t i = 0; i < trees.size(); ++i) {
+    TestAssert(matrix.at(i).at(i) == 0);
+    for (size_t j = 0; j < trees.size(); ++j) {
+      TestAssert(matrix.at(i).at(j) == matrix.at(j).at(i));
+      auto expected =
+          get_rf_distance(merges.at(i), merges.at(j), RFDistanceType::Min, false);
+      TestAssert(matrix.at(i).at(j) == expected);
+    }
+  }
+}
+
 [[maybe_unused]] static const auto test_added0 =
     add_test({[] { test_zero_rf_distance(); }, "RF distance: zero"});
 
@@ -349,3 +485,18 @@ static void test_rf_distance_different_weight_ops() {
 
 [[maybe_unused]] static const auto test_added5 =
     add_test({[] { test_rf_counter(); }, "RF distance: counter"});
+
+[[maybe_unused]] static const auto test_added6 =
+    add_test({[] { test_clade_hashes("data/testcase/full_dag.pb.gz"); },
+              "RF distance: clade hashes"});
+
+[[maybe_unused]] static const auto test_added7 =
+    add_test({[] { test_above_tree_counts("data/testcase/full_dag.pb.gz"); },
+              "RF distance: above tree counts"});
+
+[[maybe_unused]] static const auto test_added8 =
+    add_test({[] { test_rf_distance_matrix(); }, "RF distance: pairwise matrix"});
+
+[[maybe_unused]] static const auto test_added9 =
+    add_test({[] { test_above_tree_counts_multi_clade(); },
+              "RF distance: above tree counts, multiple clades"});
@@ -3,12 +3,16 @@
 #include "larch/subtree/parsimony_score.hpp"
 #include "larch/subtree/parsimony_score_binary.hpp"
 
+#include <algorithm>
 #include <iostream>
+#include <set>
 #include <string_view>
+#include <vector>
 
 #include "test_common.hpp"
 #include "larch/dag_loader.hpp"
 #include "larch/subtree/tree_count.hpp"
+#include "larch/subtree/weight_accumulator.hpp"
 #include "larch/merge/merge.hpp"
 #include "larch/benchmark.hpp"
 
@@ -47,6 +51,67 @@ static void test_sample_tree(std::string_view path) {
   test_sample_tree(dag.View());
 }
 
+static void test_enumerate_min_weight_trees(std::string_view path) {
+  MADAGStorage dag_storage = LoadDAGFromProtobuf(path);
+  dag_storage.View().RecomputeCompactGenomes(true);
+  dag_storage.View().SampleIdsFromCG(true);
+  MADAG dag = dag_storage.View();
+
+  SubtreeWeight<ParsimonyScore, MADAG> weight{dag};
+  auto min_weight = weight.ComputeWeightBelow(dag.GetRoot(), {});
+  std::set<std::vector<EdgeId>> trees;
+  size_t count = weight.EnumerateMinWeightTrees({}, [&](const auto& edges) {
+    ParsimonyScore::Weight tree_weight = 0;
+    for (EdgeId edge : edges) {
+      tree_weight += ParsimonyScore::ComputeEdge(dag, edge);
+    }
+    TestAssert(tree_weight == min_weight);
+    std::vector<EdgeId> sorted_edges(edges.begin(), edges.end());
+    std::sort(sorted_edges.begin(), sorted_edges.end());
+    TestAssert(trees.insert(std::move(sorted_edges)).second);
+    return true;
+  });
+  TestAssert(count == trees.size());
+  TestAssert(CheckedCount{count} == weight.MinWeightCount(dag.GetRoot(), {}));
+
+  size_t stopped_count = weight.EnumerateMinWeightTrees(
+      {}, [](const auto&) { return false; });
+  TestAssert(stopped_count == 1);
+}
+
+static void test_lowest_weight_trees(std::string_view path, size_t count) {
+  MADAGStorage dag_storage = LoadDAGFromProtobuf(path);
+  dag_storage.View().RecomputeCompactGenomes(true);
+  dag_storage.View().SampleIdsFromCG(true);
+  MADAG dag = dag_storage.View();
+
+  // the weights of the lowest trees are the lowest of all tree weights
+  SubtreeWeight<WeightAccumulator<ParsimonyScore>, MADAG> all_weights{dag};
+  std::vector<ParsimonyScore::Weight> expected_weights;
+  for (auto& [weight, weight_count] :
+       all_weights.ComputeWeightBelow(dag.GetRoot(), {}).GetWeights()) {
+    for (CheckedCount i = 0; i < weight_count and expected_weights.size() < count;
+         ++i) {
+      expected_weights.push_back(weight);
+    }
+  }
+
+  SubtreeWeight<ParsimonyScore, MADAG> weight{dag};
+  auto trees = weight.LowestWeightTrees({}, count);
+  TestAssert(trees.size() == expected_weights.size());
+  std::set<std::vector<EdgeId>> distinct_trees;
+  for (size_t i = 0; i < trees.size(); ++i) {
+    TestAssert(trees.at(i).weight == expected_weights.at(i));
+    ParsimonyScore::Weight tree_weight = 0;
+    for (EdgeId edge : trees.at(i).edges) {
+      tree_weight += ParsimonyScore::ComputeEdge(dag, edge);
+    }
+    TestAssert(tree_weight == trees.at(i).weight);
+    TestAssert(weight.MakeSampledTree({}, {trees.at(i).edges}).View().IsTree());
+    TestAssert(distinct_trees.insert(trees.at(i).edges).second);
+  }
+}
+
 [[maybe_unused]] static void bench_sampling(std::string_view path,
                                             std::string_view refseq_path) {
   MADAGStorage dag = LoadTreeFromProtobuf(path, LoadReferenceSequence(refseq_path));
@@ -76,6 +141,14 @@ static void test_sample_tree(std::string_view path) {
     add_test({[] { test_sample_tree("data/testcase1/full_dag.pb.gz"); },
               "Sample min weight tree: testcase1"});
 
+[[maybe_unused]] static const auto test_added5 =
+    add_test({[] { test_enumerate_min_weight_trees("data/testcase/full_dag.pb.gz"); },
+              "Sample min weight tree: enumerate all"});
+
+[[maybe_unused]] static const auto test_added6 =
+    add_test({[] { test_lowest_weight_trees("data/testcase/full_dag.pb.gz", 40); },
+              "Sample min weight tree: lowest weight trees"});
+
 // [[maybe_unused]] static const auto test_added2 =
 //     add_test({[] {
 //                 bench_sampling("data/AY.103/AY.103_start_tree_no_ancestral.pb.gz",
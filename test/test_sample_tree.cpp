@@ -24,6 +24,10 @@ static void test_sample_tree(MADAG dag) {
   SubtreeWeight<TreeCount, MADAG> tree_count{dag};
   auto result2 = tree_count.UniformSampleTree({});
   TestAssert(result2.View().IsTree());
+
+  SubtreeWeight<LogTreeCount, MADAG> log_tree_count{dag};
+  auto result3 = log_tree_count.UniformSampleTree({});
+  TestAssert(result3.View().IsTree());
 }
 
 static void test_sample_tree(std::string_view path) {
@@ -33,6 +37,74 @@ static void test_sample_tree(std::string_view path) {
   test_sample_tree(dag.View());
 }
 
+static void test_sample_trees(std::string_view path) {
+  MADAGStorage dag_storage = LoadDAGFromProtobuf(path);
+  dag_storage.View().RecomputeCompactGenomes(true);
+  dag_storage.View().SampleIdsFromCG(true);
+  MADAG dag = dag_storage.View();
+
+  SubtreeWeight<ParsimonyScore, MADAG> weight(dag);
+  const size_t count = 200;
+  auto trees = weight.SampleTrees({}, TreeSampling::Any, count, 42);
+  TestAssert(trees.size() == count);
+  // draws don't depend on scheduling
+  auto trees_again = weight.SampleTrees({}, TreeSampling::Any, count, 42);
+  for (size_t i = 0; i < count; ++i) {
+    TestAssert(trees.at(i).edges == trees_again.at(i).edges);
+  }
+
+  auto unique_trees = weight.SampleTrees({}, TreeSampling::Any, count, 42, true);
+  size_t total = 0;
+  for (auto& tree : unique_trees) {
+    total += tree.count;
+    auto storage = weight.MakeSampledTree({}, tree);
+    TestAssert(storage.View().IsTree());
+    TestAssert(storage.View().GetEdgesCount() == tree.edges.size());
+  }
+  TestAssert(total == count);
+  TestAssert(unique_trees.front().edges == trees.front().edges);
+
+  // min-weight draws all have the optimal weight
+  auto min_weight = weight.ComputeWeightBelow(dag.GetRoot(), {});
+  for (auto& tree : weight.SampleTrees({}, TreeSampling::MinWeight, 20, 7, true)) {
+    ParsimonyScore::Weight tree_weight = 0;
+    for (EdgeId edge : tree.edges) {
+      tree_weight += ParsimonyScore::ComputeEdge(dag, edge);
+    }
+    TestAssert(tree_weight == min_weight);
+  }
+
+  SubtreeWeight<TreeCount, MADAG> tree_count{dag};
+  for (auto& tree : tree_count.SampleTrees({}, TreeSampling::Uniform, 20, 7)) {
+    TestAssert(tree_count.MakeSampledTree({}, tree).View().IsTree());
+  }
+}
+
+template <typename CountOps>
+static void test_uniform_sampling(MADAG dag, size_t tree_count) {
+  SubtreeWeight<CountOps, MADAG> weight{dag};
+  const size_t draws = 20000;
+  auto trees = weight.SampleTrees({}, TreeSampling::Uniform, draws, 3, true);
+  // every tree is drawn, and none much more often than the others
+  TestAssert(trees.size() == tree_count);
+  for (auto& tree : trees) {
+    TestAssert(tree.count < 3 * draws / tree_count);
+  }
+}
+
+static void test_uniform_sampling(std::string_view path) {
+  MADAGStorage dag_storage = LoadDAGFromProtobuf(path);
+  dag_storage.View().RecomputeCompactGenomes(true);
+  dag_storage.View().SampleIdsFromCG(true);
+  MADAG dag = dag_storage.View();
+  auto tree_count = SubtreeWeight<TreeCount, MADAG>{dag}.ComputeWeightBelow(
+      dag.GetRoot(), {});
+  TestAssert(tree_count.IsSmall());
+  const auto count = static_cast<size_t>(static_cast<double>(tree_count));
+  test_uniform_sampling<TreeCount>(dag, count);
+  test_uniform_sampling<LogTreeCount>(dag, count);
+}
+
 [[maybe_unused]] static void bench_sampling(std::string_view path,
                                             std::string_view refseq_path) {
   MADAGStorage dag = LoadTreeFromProtobuf(path, LoadReferenceSequence(refseq_path));
@@ -62,6 +134,14 @@ static void test_sample_tree(std::string_view path) {
     add_test({[] { test_sample_tree("data/testcase1/full_dag.pb.gz"); },
               "Sample tree: testcase1"});
 
+[[maybe_unused]] static const auto test_added5 =
+    add_test({[] { test_sample_trees("data/testcase/full_dag.pb.gz"); },
+              "Sample tree: batch of seeded trees"});
+
+[[maybe_unused]] static const auto test_added6 =
+    add_test({[] { test_uniform_sampling("data/testcase/full_dag.pb.gz"); },
+              "Sample tree: uniform over trees"});
+
 // [[maybe_unused]] static const auto test_added2 =
 //     add_test({[] {
 //                 bench_sampling("data/AY.103/AY.103_start_tree_no_ancestral.pb.gz",
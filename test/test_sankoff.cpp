@@ -1,6 +1,10 @@
 #include "larch/subtree/sankoff.hpp"
 #include "larch/subtree/parsimony_score.hpp"
 #include "larch/subtree/subtree_weight.hpp"
+#include "larch/benchmark.hpp"
+
+#include <random>
+#include <string_view>
 
 #include "sample_dag.hpp"
 #include "test_common.hpp"
@@ -475,7 +479,7 @@ static void test_sankoff_four_sites() {
   double sum_of_sites = 0.0;
 
   for (size_t site_idx = 0; site_idx < 4; ++site_idx) {
-    const SiteCosts& costs = dp_table.dp_costs[root_idx][site_idx];
+    const SiteCosts costs = dp_table.GetSiteCosts(root_idx, site_idx);
     double min_cost = *std::min_element(costs.begin(), costs.end());
     sum_of_sites += min_cost;
     TestAssert(std::abs(min_cost - expected_site_scores[site_idx]) < 1e-9);
@@ -585,7 +589,7 @@ static void test_sankoff_larger_tree() {
   size_t root_idx = root.GetId().value;
   double sum_of_sites = 0.0;
   for (size_t site_idx = 0; site_idx < scorer.GetNumVariableSites(); ++site_idx) {
-    const SiteCosts& costs = dp_table.dp_costs[root_idx][site_idx];
+    const SiteCosts costs = dp_table.GetSiteCosts(root_idx, site_idx);
     double min_cost = *std::min_element(costs.begin(), costs.end());
     TestAssert(min_cost >= 0.0);
     sum_of_sites += min_cost;
@@ -814,7 +818,7 @@ static void test_sankoff_dag_sampled_tree() {
   size_t root_idx = root.GetId().value;
   double sum_of_sites = 0.0;
   for (size_t site_idx = 0; site_idx < scorer.GetNumVariableSites(); ++site_idx) {
-    const SiteCosts& costs = dp_table.dp_costs[root_idx][site_idx];
+    const SiteCosts costs = dp_table.GetSiteCosts(root_idx, site_idx);
     double min_cost = *std::min_element(costs.begin(), costs.end());
     sum_of_sites += min_cost;
   }
@@ -842,3 +846,129 @@ static void test_sankoff_dag_sampled_tree() {
 
 [[maybe_unused]] static const auto test_sankoff_dag_sampled_tree_registered =
     add_test({test_sankoff_dag_sampled_tree, "Sankoff: DAG sampled tree", {"sankoff"}});
+
+// 4. The site-vectorized min-plus kernel matches the scalar one, including
+// infinite costs and ties.
+static void test_sankoff_min_plus_kernel() {
+  std::mt19937 random_generator{42};
+  for (size_t iteration = 0; iteration < 2000; ++iteration) {
+    const size_t count = random_generator() % 23;
+    std::vector<double> costs(16 * count), child(4 * count), parent(4 * count);
+    for (auto& cost : costs) {
+      cost = random_generator() % 5 == 0 ? kSankoffInfinity
+                                         : 0.5 * (random_generator() % 4);
+    }
+    for (auto& cost : child) {
+      cost = random_generator() % 3 == 0 ? kSankoffInfinity : random_generator() % 4;
+    }
+    for (auto& cost : parent) {
+      cost = random_generator() % 3;
+    }
+    std::vector<double> expected_parent = parent;
+    std::vector<uint8_t> traceback(4 * count), expected_traceback(4 * count);
+    SankoffMinPlus(costs.data(), child.data(), parent.data(), traceback.data(), count);
+    SankoffMinPlusScalar(costs.data(), child.data(), expected_parent.data(),
+                         expected_traceback.data(), count);
+    TestAssert(parent == expected_parent);
+    TestAssert(traceback == expected_traceback);
+  }
+}
+
+[[maybe_unused]] static const auto test_sankoff_min_plus_kernel_registered = add_test(
+    {test_sankoff_min_plus_kernel, "Sankoff: Min-plus kernel", {"sankoff"}});
+
+// Score `dag` with a non-uniform matrix, and check that the DP table is what the
+// scalar kernel computes from the children of every node.
+static void check_sankoff_kernel(MADAG dag) {
+  SiteCostMatrix matrix;
+  for (size_t i = 0; i < 4; ++i) {
+    for (size_t j = 0; j < 4; ++j) {
+      // transitions (A<->G, C<->T) are cheaper than transversions
+      matrix[i][j] = i == j ? 0.0 : ((i + j) % 2 == 0 ? 0.5 : 1.25);
+    }
+  }
+  SankoffScorer<MADAG> scorer{dag, matrix};
+  scorer.ComputeScoreBelow(dag.GetRoot());
+
+  // check the DP table against the scalar kernel, untimed
+  const auto& dp_table = scorer.GetDPTable();
+  const size_t num_sites = scorer.GetNumVariableSites();
+  struct EdgeWork {
+    const double* child;
+    size_t parent;
+  };
+  std::vector<EdgeWork> work;
+  size_t parents_count = 0;
+  for (auto node : dag.GetNodes()) {
+    if (node.IsLeaf()) {
+      continue;
+    }
+    std::vector<double> costs(4 * num_sites, 0.0);
+    for (auto clade : node.GetClades()) {
+      for (EdgeId edge_id : clade) {
+        const double* child =
+            dp_table.dp_costs.at(dag.Get(edge_id).GetChildId().value).data();
+        std::vector<uint8_t> traceback(4 * num_sites);
+        SankoffMinPlusScalar(dp_table.cost_planes.data(), child, costs.data(),
+                             traceback.data(), num_sites);
+        TestAssert(traceback == dp_table.traceback.at(edge_id.value));
+        work.push_back({child, parents_count});
+      }
+    }
+    TestAssert(costs == dp_table.dp_costs.at(node.GetId().value));
+    ++parents_count;
+  }
+
+  // time both kernels on the same edges, into buffers allocated up front
+  auto time_kernel = [&](auto kernel, std::vector<double>& costs,
+                         std::vector<uint8_t>& traceback) {
+    costs.assign(4 * num_sites * parents_count, 0.0);
+    traceback.assign(4 * num_sites * work.size(), 0);
+    Benchmark time;
+    for (size_t i = 0; i < work.size(); ++i) {
+      kernel(dp_table.cost_planes.data(), work[i].child,
+             costs.data() + 4 * num_sites * work[i].parent,
+             traceback.data() + 4 * num_sites * i, num_sites);
+    }
+    time.stop();
+    return time.durationMs();
+  };
+  std::vector<double> scalar_costs, vector_costs;
+  std::vector<uint8_t> scalar_traceback, vector_traceback;
+  const auto scalar_ms = time_kernel(
+      [](auto... args) { SankoffMinPlusScalar(args...); }, scalar_costs,
+      scalar_traceback);
+  const auto vector_ms = time_kernel([](auto... args) { SankoffMinPlus(args...); },
+                                     vector_costs, vector_traceback);
+  TestAssert(scalar_costs == vector_costs);
+  TestAssert(scalar_traceback == vector_traceback);
+  std::cout << num_sites << " sites, " << work.size() << " edges, scalar " << scalar_ms
+            << " ms, vector width " << SankoffKernels::Width << " " << vector_ms
+            << " ms ";
+}
+
+static void test_sankoff_kernel_on_tree(std::string_view path) {
+  MADAGStorage dag_storage = LoadDAGFromProtobuf(path);
+  dag_storage.View().RecomputeCompactGenomes(true);
+  check_sankoff_kernel(dag_storage.View());
+}
+
+[[maybe_unused]] static const auto test_sankoff_kernel_on_tree_registered =
+    add_test({[] { test_sankoff_kernel_on_tree("data/test_5_trees/tree_0.pb.gz"); },
+              "Sankoff: Vectorized DP matches scalar",
+              {"sankoff"}});
+
+static void bench_sankoff_kernel(std::string_view path, std::string_view refseq_path) {
+  MADAGStorage dag_storage =
+      LoadTreeFromProtobuf(path, LoadReferenceSequence(refseq_path));
+  dag_storage.View().RecomputeCompactGenomes(true);
+  check_sankoff_kernel(dag_storage.View());
+}
+
+[[maybe_unused]] static const auto bench_sankoff_kernel_registered =
+    add_test({[] {
+                bench_sankoff_kernel("data/seedtree/seedtree.pb.gz",
+                                     "data/seedtree/refseq.txt.gz");
+              },
+              "Sankoff: Vectorized DP benchmark",
+              {"sankoff", "slow"}});
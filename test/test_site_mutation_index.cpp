@@ -0,0 +1,77 @@
+#include "larch/madag/site_mutation_index.hpp"
+
+#include <algorithm>
+#include <map>
+#include <string_view>
+#include <vector>
+
+#include "test_common.hpp"
+
+static void assert_matches_scan(MADAG dag, const SiteMutationIndex& index) {
+  std::map<size_t, std::vector<EdgeId>> expected;
+  for (auto edge : dag.GetEdges()) {
+    for (auto [pos, nucs] : edge.GetEdgeMutations()) {
+      expected[pos.value].push_back(edge.GetId());
+    }
+  }
+  for (auto& [site, edges] : expected) {
+    std::sort(edges.begin(), edges.end());
+  }
+
+  auto sites = index.GetSites();
+  TestAssert(sites.size() == expected.size());
+  for (auto site : sites) {
+    TestAssert(index.GetEdges(site) == expected.at(site.value));
+    TestAssert(index.GetCount(site) == expected.at(site.value).size());
+    auto nodes = index.GetNodes(dag, site);
+    TestAssert(nodes.size() == expected.at(site.value).size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      TestAssert(nodes.at(i) == dag.Get(expected.at(site.value).at(i)).GetChildId());
+    }
+  }
+}
+
+static void test_site_mutation_index(std::string_view path) {
+  MADAGStorage<> dag_storage = LoadDAGFromProtobuf(path);
+  MutableMADAG dag = dag_storage.View();
+  SiteMutationIndex index = SiteMutationIndex::Build(dag);
+  assert_matches_scan(dag, index);
+  TestAssert(index.GetEdges({dag.GetReferenceSequence().size() + 100}).empty());
+
+  // move one edge's mutations to unused sites and back, updating the index
+  // incrementally
+  auto sites = index.GetSites();
+  MutationPosition unused{1};
+  while (unused.value < dag.GetReferenceSequence().size() and
+         index.GetCount(unused) > 0) {
+    ++unused.value;
+  }
+  TestAssert(index.GetCount(unused) == 0);
+  auto edge = dag.Get(index.GetEdges(sites.front()).front());
+  EdgeMutations original = edge.GetEdgeMutations().Copy(&edge);
+  EdgeMutations changed = edge.GetEdgeMutations().Copy(&edge);
+  char ref_base = dag.GetReferenceSequence().at(unused.value - 1);
+  changed[unused] = {ref_base, ref_base == 'A' ? 'C' : 'A'};
+
+  index.UpdateEdge(edge.GetId(), original, changed);
+  edge.SetEdgeMutations(changed.Copy(&edge));
+  assert_matches_scan(dag, index);
+  TestAssert(index.GetEdges(unused) == std::vector<EdgeId>{edge.GetId()});
+
+  index.RemoveEdge(edge.GetId(), changed);
+  edge.SetEdgeMutations({});
+  assert_matches_scan(dag, index);
+
+  index.AddEdge(edge.GetId(), original);
+  edge.SetEdgeMutations(original.Copy(&edge));
+  assert_matches_scan(dag, index);
+  TestAssert(index.GetCount(unused) == 0);
+}
+
+[[maybe_unused]] static const auto test_added0 =
+    add_test({[] { test_site_mutation_index("data/test_5_trees/tree_0.pb.gz"); },
+              "Site mutation index: tree"});
+
+[[maybe_unused]] static const auto test_added1 =
+    add_test({[] { test_site_mutation_index("data/testcase/full_dag.pb.gz"); },
+              "Site mutation index: DAG"});
@@ -6,7 +6,12 @@
 
 #include "test_common.hpp"
 
+#include "larch/benchmark.hpp"
 #include "larch/dag_loader.hpp"
+#include "larch/merge/merge.hpp"
+#include "larch/subtree/fused_weight_ops.hpp"
+#include "larch/subtree/tree_count.hpp"
+#include "larch/subtree/ua_free_parsimony_score.hpp"
 
 static void test_subtree_weight(MADAG dag, size_t expected_score) {
   SubtreeWeight<BinaryParsimonyScore, MADAG> weight(dag);
@@ -31,3 +36,237 @@ static void test_subtree_weight(std::string_view path, size_t expected_score) {
 [[maybe_unused]] static const auto test_added1 =
     add_test({[] { test_subtree_weight("data/testcase1/full_dag.pb.gz", 75); },
               "Subtree weight: testcase1"});
+
+// DAG with `levels` levels of `width` nodes, where node k of a level has two
+// clades with edges to nodes 2k + c and 2k + c + 1 (mod width) of the next
+// level, and the UA has edges to all nodes of the first level. Node ids
+// increase with the level, and the UA is the last node.
+static MADAGStorage<> make_layered_dag(size_t levels, size_t width) {
+  const std::string reference_sequence = "ACGT";
+  MADAGStorage<> dag_storage = MADAGStorage<>::EmptyDefault();
+  auto dag = dag_storage.View();
+  dag.SetReferenceSequence(reference_sequence);
+  dag.InitializeNodes(levels * width + 1);
+  const NodeId ua{levels * width};
+
+  size_t edge_id = 0;
+  auto add_edge = [&](NodeId parent, NodeId child, CladeIdx clade) {
+    auto edge = dag.AddEdge({edge_id}, parent, child, clade);
+    if (edge_id % 3 != 0) {
+      const size_t pos = edge_id % reference_sequence.size();
+      const char ref_base = reference_sequence.at(pos);
+      edge.GetMutableEdgeMutations()[{pos + 1}] = {ref_base,
+                                                   ref_base == 'A' ? 'C' : 'A'};
+    }
+    ++edge_id;
+  };
+  for (size_t k = 0; k < width; ++k) {
+    add_edge(ua, {k}, {0});
+  }
+  for (size_t level = 0; level + 1 < levels; ++level) {
+    for (size_t k = 0; k < width; ++k) {
+      const NodeId parent{level * width + k};
+      for (size_t clade = 0; clade < 2; ++clade) {
+        for (size_t offset = 0; offset < std::min<size_t>(width, 2); ++offset) {
+          const size_t child = (2 * k + clade + offset) % width;
+          add_edge(parent, {(level + 1) * width + child}, {clade});
+        }
+      }
+    }
+  }
+  dag.BuildConnections();
+  return dag_storage;
+}
+
+// Evaluate every node of a DAG from make_layered_dag in decreasing id order,
+// which visits children before parents.
+template <typename WeightOps>
+static std::vector<typename WeightOps::Weight> layered_dag_weights(
+    MADAG dag, const WeightOps& weight_ops) {
+  std::vector<typename WeightOps::Weight> result(dag.GetNodesCount());
+  for (size_t id = dag.GetNodesCount() - 1; id < dag.GetNodesCount(); --id) {
+    auto node = dag.Get(NodeId{id});
+    if (node.IsLeaf()) {
+      result.at(id) = weight_ops.ComputeLeaf(dag, node.GetId());
+      continue;
+    }
+    std::vector<typename WeightOps::Weight> cladeweights;
+    for (auto clade : node.GetClades()) {
+      std::vector<typename WeightOps::Weight> edge_weights;
+      for (auto edge_id : clade) {
+        edge_weights.push_back(
+            weight_ops.AboveNode(weight_ops.ComputeEdge(dag, edge_id),
+                                 result.at(dag.Get(edge_id).GetChildId().value)));
+      }
+      cladeweights.push_back(weight_ops.WithinCladeAccumOptimum(edge_weights).first);
+    }
+    result.at(id) = weight_ops.BetweenClades(cladeweights);
+  }
+  return result;
+}
+
+// The number of minimum weight trees below every node of a DAG from
+// make_layered_dag, given the weights from layered_dag_weights.
+template <typename WeightOps>
+static std::vector<CheckedCount> layered_dag_min_weight_counts(
+    MADAG dag, const WeightOps& weight_ops,
+    const std::vector<typename WeightOps::Weight>& weights) {
+  std::vector<CheckedCount> result(dag.GetNodesCount(), 1);
+  for (size_t id = dag.GetNodesCount() - 1; id < dag.GetNodesCount(); --id) {
+    for (auto clade : dag.Get(NodeId{id}).GetClades()) {
+      std::vector<typename WeightOps::Weight> edge_weights;
+      std::vector<NodeId> children;
+      for (auto edge_id : clade) {
+        children.push_back(dag.Get(edge_id).GetChildId());
+        edge_weights.push_back(
+            weight_ops.AboveNode(weight_ops.ComputeEdge(dag, edge_id),
+                                 weights.at(children.back().value)));
+      }
+      CheckedCount cladecount = 0;
+      for (size_t idx : weight_ops.WithinCladeAccumOptimum(edge_weights).second) {
+        cladecount += result.at(children.at(idx).value);
+      }
+      result.at(id) *= cladecount;
+    }
+  }
+  return result;
+}
+
+template <typename WeightOps>
+static void test_layered_dag_weights(size_t levels, size_t width) {
+  MADAGStorage<> dag_storage = make_layered_dag(levels, width);
+  MADAG dag = dag_storage.View();
+  const auto expected = layered_dag_weights(dag, WeightOps{});
+
+  // start below the root first, so that the evaluation from the root reuses
+  // cached weights
+  SubtreeWeight<WeightOps, MADAG> weight{dag};
+  const NodeId middle{(levels / 2) * width};
+  TestAssert(weight.ComputeWeightBelow(dag.Get(middle), {}) ==
+             expected.at(middle.value));
+  TestAssert(weight.ComputeWeightBelow(dag.GetRoot(), {}) ==
+             expected.at(dag.GetRoot().GetId().value));
+  for (auto node : dag.GetNodes()) {
+    TestAssert(weight.ComputeWeightBelow(node, {}) == expected.at(node.GetId().value));
+  }
+
+  const auto expected_counts =
+      layered_dag_min_weight_counts(dag, WeightOps{}, expected);
+  TestAssert(weight.MinWeightCount(dag.Get(middle), {}) ==
+             expected_counts.at(middle.value));
+  TestAssert(weight.MinWeightCount(dag.GetRoot(), {}) ==
+             expected_counts.at(dag.GetRoot().GetId().value));
+}
+
+[[maybe_unused]] static const auto test_added2 = add_test(
+    {[] {
+       test_layered_dag_weights<BinaryParsimonyScore>(100, 200);
+       test_layered_dag_weights<TreeCount>(20, 50);
+     },
+     "Subtree weight: parallel evaluation"});
+
+[[maybe_unused]] static const auto test_added3 =
+    add_test({[] { test_layered_dag_weights<BinaryParsimonyScore>(200000, 1); },
+              "Subtree weight: deep DAG"});
+
+static void bench_compute_weight_below() {
+  // about 10^6 nodes and 4 * 10^6 edges
+  MADAGStorage<> dag_storage = make_layered_dag(1000, 1000);
+  MADAG dag = dag_storage.View();
+  constexpr size_t iterations = 5;
+  Benchmark bench;
+  for (size_t i = 0; i < iterations; ++i) {
+    SubtreeWeight<BinaryParsimonyScore, MADAG> weight{dag};
+    std::ignore = weight.ComputeWeightBelow(dag.GetRoot(), {});
+  }
+  bench.stop();
+  std::cout << dag.GetNodesCount() * iterations * 1000 /
+                   std::max<size_t>(1, static_cast<size_t>(bench.durationMs()))
+            << " nodes/s ";
+}
+
+[[maybe_unused]] static const auto test_added4 =
+    add_test({bench_compute_weight_below,
+              "Subtree weight: ComputeWeightBelow benchmark",
+              {"slow"}});
+
+static void test_update_after_merge() {
+  std::vector<MADAGStorage<>> trees;
+  for (size_t i = 0; i < 5; ++i) {
+    trees.push_back(
+        LoadDAGFromProtobuf("data/test_5_trees/tree_" + std::to_string(i) + ".pb.gz"));
+    trees.back().View().RecomputeCompactGenomes(true);
+    trees.back().View().SampleIdsFromCG(true);
+  }
+  Merge merge{trees.front().View().GetReferenceSequence()};
+  merge.AddDAG(trees.front().View());
+  merge.ComputeResultEdgeMutations();
+
+  SubtreeWeight<BinaryParsimonyScore, MergeDAG> parsimony{merge.GetResult()};
+  SubtreeWeight<TreeCount, MergeDAG> tree_count{merge.GetResult()};
+  std::ignore = parsimony.ComputeWeightBelow(merge.GetResult().GetRoot(), {});
+  std::ignore = parsimony.MinWeightCount(merge.GetResult().GetRoot(), {});
+  std::ignore = tree_count.ComputeWeightBelow(merge.GetResult().GetRoot(), {});
+
+  for (size_t i = 1; i < trees.size(); ++i) {
+    merge.ClearUpdatedNodes();
+    merge.AddDAG(trees.at(i).View());
+    merge.ComputeResultEdgeMutations();
+    TestAssert(not merge.GetUpdatedNodes().empty());
+    parsimony.Update(merge.GetUpdatedNodes());
+    tree_count.Update(merge.GetUpdatedNodes());
+
+    // the updated weights must match a computation from scratch on every node
+    SubtreeWeight<BinaryParsimonyScore, MergeDAG> parsimony_expected{
+        merge.GetResult()};
+    SubtreeWeight<TreeCount, MergeDAG> tree_count_expected{merge.GetResult()};
+    auto root = merge.GetResult().GetRoot();
+    TestAssert(parsimony.MinWeightCount(root, {}) ==
+               parsimony_expected.MinWeightCount(root, {}));
+    for (auto node : merge.GetResult().GetNodes()) {
+      TestAssert(parsimony.ComputeWeightBelow(node, {}) ==
+                 parsimony_expected.ComputeWeightBelow(node, {}));
+      TestAssert(tree_count.ComputeWeightBelow(node, {}) ==
+                 tree_count_expected.ComputeWeightBelow(node, {}));
+    }
+  }
+}
+
+[[maybe_unused]] static const auto test_added5 =
+    add_test({test_update_after_merge, "Subtree weight: update after merge"});
+
+static void test_fused_weight_ops(std::string_view path) {
+  MADAGStorage dag_storage = LoadDAGFromProtobuf(path);
+  auto dag = dag_storage.View();
+  dag.RecomputeCompactGenomes(true);
+  dag.SampleIdsFromCG(true);
+  MADAG const_dag = dag;
+  auto root = const_dag.GetRoot();
+
+  SubtreeWeight<FusedWeightOps<TreeCount, BinaryParsimonyScore, MaxBinaryParsimonyScore,
+                               UAFreeParsimonyScore>,
+                MADAG>
+      fused{const_dag};
+  auto [tree_count, min_parsimony, max_parsimony, ua_free_parsimony] =
+      fused.ComputeWeightBelow(root, {});
+
+  SubtreeWeight<TreeCount, MADAG> tree_count_expected{const_dag};
+  SubtreeWeight<BinaryParsimonyScore, MADAG> min_parsimony_expected{const_dag};
+  SubtreeWeight<MaxBinaryParsimonyScore, MADAG> max_parsimony_expected{const_dag};
+  SubtreeWeight<UAFreeParsimonyScore, MADAG> ua_free_parsimony_expected{const_dag};
+  TestAssert(tree_count.first == tree_count_expected.ComputeWeightBelow(root, {}));
+  TestAssert(min_parsimony.first ==
+             min_parsimony_expected.ComputeWeightBelow(root, {}));
+  TestAssert(min_parsimony.second == min_parsimony_expected.MinWeightCount(root, {}));
+  TestAssert(max_parsimony.first ==
+             max_parsimony_expected.ComputeWeightBelow(root, {}));
+  TestAssert(max_parsimony.second == max_parsimony_expected.MinWeightCount(root, {}));
+  TestAssert(ua_free_parsimony.first ==
+             ua_free_parsimony_expected.ComputeWeightBelow(root, {}));
+  TestAssert(ua_free_parsimony.second ==
+             ua_free_parsimony_expected.MinWeightCount(root, {}));
+}
+
+[[maybe_unused]] static const auto test_added6 =
+    add_test({[] { test_fused_weight_ops("data/testcase/full_dag.pb.gz"); },
+              "Subtree weight: fused weight ops"});
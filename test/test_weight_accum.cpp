@@ -61,3 +61,29 @@ static void test_weight_accum(std::string_view path, Weight expected_scores) {
                                   Weight({{78, 3}, {79, 2}, {76, 1}, {75, 1}}, {}));
               },
               "Parsimony Counting: testcase1"});
+
+static void test_lowest_weights(std::string_view path, size_t max_weights) {
+  MADAGStorage<> dag = LoadDAGFromProtobuf(path);
+  auto dag_view = dag.View();
+  dag_view.RecomputeCompactGenomes(true);
+  dag_view.SampleIdsFromCG(true);
+
+  SubtreeWeight<WeightAccumulator<ParsimonyScore>, MADAG> all_weights(dag_view);
+  Weight scores = all_weights.ComputeWeightBelow(dag_view.GetRoot(), {});
+  SubtreeWeight<WeightAccumulator<ParsimonyScore>, MADAG> lowest_weights(dag_view);
+  Weight lowest_scores = lowest_weights.ComputeWeightBelow(
+      dag_view.GetRoot(), WeightAccumulator<ParsimonyScore>{{}, max_weights});
+
+  // the lowest weights are counted exactly
+  TestAssert(lowest_scores.GetWeights().size() == max_weights);
+  auto expected = scores.GetWeights().begin();
+  for (auto& [score, count] : lowest_scores.GetWeights()) {
+    TestAssert(score == expected->first);
+    TestAssert(count == expected->second);
+    ++expected;
+  }
+}
+
+[[maybe_unused]] static const auto test_added2 =
+    add_test({[] { test_lowest_weights("data/testcase/full_dag.pb.gz", 3); },
+              "Parsimony Counting: lowest weights"});
@@ -85,3 +85,23 @@ static void test_counter_multiply(Counter lhs, Counter rhs, Counter expected_cou
                         make_counter({0, 1, 2, 2, 3, 2, 2, 2, 3, 4}));
      },
      "Counter: add2"});
+
+[[maybe_unused]] static const auto test_added6 = add_test(
+    {[] {
+       // weights too far apart for a dense convolution
+       test_counter_multiply(make_counter({0, 100000, 100000}),
+                             make_counter({1, 200000}),
+                             make_counter({1, 100001, 100001, 200000, 300000, 300000}));
+     },
+     "Counter: multiply sparse"});
+
+[[maybe_unused]] static const auto test_added7 = add_test(
+    {[] {
+       Counter lhs({2, 2, 3, 5}, {}, 2);
+       TestAssert(lhs == make_counter({2, 2, 3}));
+       Counter product = lhs * make_counter({0, 0, 1, 9});
+       TestAssert(product.GetMaxWeights() == 2);
+       TestAssert(product == make_counter({2, 2, 2, 2, 3, 3, 3, 3}));
+       TestAssert(lhs + make_counter({1, 4}) == make_counter({1, 2, 2}));
+     },
+     "Counter: lowest weights"});
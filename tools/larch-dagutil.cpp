@@ -1,4 +1,5 @@
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <vector>
 #include <algorithm>
@@ -12,6 +13,7 @@
 #include "larch/subtree/parsimony_score_binary.hpp"
 #include "tools_common.hpp"
 #include "larch/rf_distance.hpp"
+#include "larch/rf_distance_matrix.hpp"
 #include "larch/merge/merge.hpp"
 #include "larch/dag_loader.hpp"
 #include "larch/benchmark.hpp"
@@ -34,9 +36,15 @@
       {"-t,--trim", "Trim output (default: best parsimony)"},
       {"--rf FILE", "Trim output to minimize RF distance to provided DAG file"},
       {"-s,--sample", "Sample a single tree from DAG"},
+      {"--top-k INT",
+       "Print the parsimony scores of the INT most parsimonious trees, and \n"
+       "output a DAG of only these trees"},
       {"--dag-info", "Print DAG info (parsimony scores, sum RF distances)"},
       {"--parsimony", "Print all DAG parsimony scores"},
       {"--sum-rf-distance", "Print all DAG sum RF distances"},
+      {"--rf-matrix FILE",
+       "Write the RF distances between all pairs of input trees to FILE as a \n"
+       "tab-separated matrix, instead of merging them"},
       {"--input-format ENUM [...]",
        "Specify input file formats (default: inferred) \n"
        "[dagbin, dag-pb, tree-pb, dag-json]"},
@@ -53,10 +61,54 @@
   std::exit(EXIT_SUCCESS);
 }
 
+static void WriteRFMatrix(const std::vector<std::string_view>& input_paths,
+                          const std::vector<FileFormat>& input_formats,
+                          std::string refseq_path, std::string_view matrix_path) {
+  std::vector<MADAGStorage<>> trees;
+  std::vector<size_t> trees_id;
+  for (size_t i = 0; i < input_paths.size(); ++i) {
+    trees_id.push_back(i);
+    trees.push_back(MADAGStorage<>::EmptyDefault());
+  }
+  std::cout << "Loading trees... ";
+  ParallelForEach(trees_id, [&](auto tree_id) {
+    trees.at(tree_id) =
+        LoadDAG(input_paths.at(tree_id), input_formats.at(tree_id), refseq_path);
+  });
+  std::cout << " done.\n";
+  std::vector<MADAG> tree_refs{trees.begin(), trees.end()};
+  for (size_t i = 0; i < tree_refs.size(); ++i) {
+    if (not tree_refs.at(i).IsTree()) {
+      std::cerr << "Input '" << input_paths.at(i) << "' is not a tree.\n";
+      Fail();
+    }
+  }
+
+  Benchmark rf_time;
+  rf_time.start();
+  auto matrix = ComputeRFDistanceMatrix(tree_refs);
+  rf_time.stop();
+  std::cout << "RF matrix computed in " << rf_time.durationMs() << " ms\n";
+
+  std::ofstream out{std::string{matrix_path}};
+  for (auto input_path : input_paths) {
+    out << '\t' << input_path;
+  }
+  out << '\n';
+  for (size_t i = 0; i < matrix.size(); ++i) {
+    out << input_paths.at(i);
+    for (size_t distance : matrix.at(i)) {
+      out << '\t' << distance;
+    }
+    out << '\n';
+  }
+}
+
 static void MergeTrees(const std::vector<std::string_view>& input_paths,
                        const std::vector<FileFormat>& input_formats,
                        std::string refseq_path, std::string_view output_path,
                        FileFormat output_format, bool trim, bool sample_tree,
+                       size_t top_k,
                        std::string rf_path, FileFormat rf_format,
                        bool do_print_dag_info, bool do_print_parsimony,
                        bool do_print_rf_distance, std::string vcf_path) {
@@ -158,6 +210,33 @@ static void MergeTrees(const std::vector<std::string_view>& input_paths,
     }
   }
 
+  if (top_k > 0) {
+    SubtreeWeight<BinaryParsimonyScore, MergeDAG> weight{merge.GetResult()};
+    auto top_trees = weight.LowestWeightTrees({}, top_k);
+    std::cout << "top_k_parsimony: " << top_trees.size() << "\n";
+    for (const auto& tree : top_trees) {
+      std::cout << tree.weight << "\n";
+    }
+    if (!output_path.empty()) {
+      using SampledStorage =
+          SubtreeWeight<BinaryParsimonyScore, MergeDAG>::SampledDAGStorage;
+      std::vector<SampledStorage> top_storages;
+      for (auto& tree : top_trees) {
+        top_storages.push_back(
+            weight.MakeSampledTree({}, SampledTreeEdges{std::move(tree.edges)}));
+      }
+      Merge top_merge{merge.GetResult().GetReferenceSequence()};
+      std::vector<decltype(top_storages.front().View())> top_views;
+      for (auto& storage : top_storages) {
+        top_views.push_back(storage.View());
+      }
+      top_merge.AddDAGs(top_views);
+      top_merge.ComputeResultEdgeMutations();
+      StoreDAG(top_merge.GetResult(), output_path, output_format);
+    }
+    return;
+  }
+
   if (!output_path.empty()) {
     if (trim) {
       if (rf_path.empty()) {
@@ -209,9 +288,11 @@ int main(int argc, char** argv) try {
   std::string refseq_path;
   std::string rf_path;
   std::string vcf_path;
+  std::string rf_matrix_path;
   FileFormat rf_format = FileFormat::Infer;
   bool trim = false;
   bool sample_tree = false;
+  size_t top_k = 0;
   bool do_print_dag_info = false;
   bool do_print_parsimony = false;
   bool do_print_rf_distance = false;
@@ -237,6 +318,8 @@ int main(int argc, char** argv) try {
     } else if (name == "-s" or name == "--sample") {
       ParseOption<false>(name, params, sample_tree, 0);
       sample_tree = true;
+    } else if (name == "--top-k") {
+      ParseOption(name, params, top_k, 1);
     } else if (name == "-v" or name == "--VCF-input-file") {
       ParseOption(name, params, vcf_path, 1);
     } else if (name == "--force-no-vcf") {
@@ -254,6 +337,8 @@ int main(int argc, char** argv) try {
       ParseOption<false>(name, params, do_print_rf_distance, 0);
       do_print_dag_info = true;
       do_print_rf_distance = true;
+    } else if (name == "--rf-matrix") {
+      ParseOption(name, params, rf_matrix_path, 1);
     } else if (name == "--input-format") {
       ParseOption<false>(name, params, input_formats, -1);
       for (auto param : params) {
@@ -289,7 +374,7 @@ int main(int argc, char** argv) try {
     std::cerr << "Specify input format for each input file.\n";
     Fail();
   }
-  if (vcf_path.empty() and (not no_vcf)) {
+  if (vcf_path.empty() and (not no_vcf) and rf_matrix_path.empty()) {
     std::cerr << "Specify an input VCF file or use flag '--force-no-vcf'.\n";
     Fail();
   }
@@ -319,9 +404,14 @@ int main(int argc, char** argv) try {
     }
   }
 
+  if (not rf_matrix_path.empty()) {
+    WriteRFMatrix(input_paths, input_formats, refseq_path, rf_matrix_path);
+    return EXIT_SUCCESS;
+  }
+
   MergeTrees(input_paths, input_formats, refseq_path, output_path, output_format, trim,
-             sample_tree, rf_path, rf_format, do_print_dag_info, do_print_parsimony,
-             do_print_rf_distance, vcf_path);
+             sample_tree, top_k, rf_path, rf_format, do_print_dag_info,
+             do_print_parsimony, do_print_rf_distance, vcf_path);
   return EXIT_SUCCESS;
 } catch (std::exception& e) {
   std::cerr << "Uncaught exception: " << e.what() << std::endl;
@@ -11,6 +11,7 @@
 #include "larch/dag_loader.hpp"
 #include "larch/subtree/subtree_weight.hpp"
 #include "larch/subtree/weight_accumulator.hpp"
+#include "larch/subtree/fused_weight_ops.hpp"
 #include "larch/subtree/tree_count.hpp"
 #include "larch/subtree/parsimony_score_binary.hpp"
 #include "larch/subtree/parsimony_score.hpp"
@@ -71,6 +72,9 @@
        "Callback configuration choice (default: merge all profitable moves) \n"
        "[best-move, best-move-fixed-tree, best-move-treebased, all-moves]"},
       {"--trim", "Trim optimized DAG after final iteration"},
+      {"--memory-usage",
+       "Print memory used by the merged DAG and merge tables, broken down by \n"
+       "feature, after each iteration"},
       {"--keep-fragment-uncollapsed",
        "Keep empty fragment edges, rather than collapsing them"},
       {"--input-format ENUM",
@@ -551,6 +555,7 @@ int main(int argc, char** argv) {  // NOLINT(bugprone-exception-escape)
   bool use_ua_free_parsimony = false;
   bool collapse_empty_fragment_edges = true;
   bool final_trim = false;
+  bool print_memory_usage = false;
   bool plateau_stopping_condition = false;
   size_t current_parsimony_change_window_size = 0;
   size_t last_parsimony_change_window_size = 1;
@@ -641,6 +646,9 @@ int main(int argc, char** argv) {  // NOLINT(bugprone-exception-escape)
     } else if (name == "--trim") {
       ParseOption<false>(name, params, final_trim, 0);
       final_trim = true;
+    } else if (name == "--memory-usage") {
+      ParseOption<false>(name, params, print_memory_usage, 0);
+      print_memory_usage = true;
     } else if (name == "--input-format") {
       std::string temp;
       ParseOption(name, params, temp, 1);
@@ -749,50 +757,50 @@ int main(int argc, char** argv) {  // NOLINT(bugprone-exception-escape)
   merge.ComputeResultEdgeMutations();
 
   Benchmark log_timer;
+  // All parsimony scores and the tree count are computed in a single pass over
+  // the DAG. The scorer is kept across iterations, and only recomputes the
+  // nodes updated by merging since the previous iteration.
+  using LoggerWeightOps = FusedWeightOps<TreeCount, BinaryParsimonyScore,
+                                         MaxBinaryParsimonyScore, UAFreeParsimonyScore>;
+  SubtreeWeight<LoggerWeightOps, MergeDAG> logger_scorer{merge.GetResult()};
   auto logger = [&merge, &logfile, &log_timer, &intermediate_dag_path,
                  &write_intermediate_dag, &write_intermediate_every_x_iters,
-                 &output_format, &use_ua_free_parsimony](size_t iteration) {
+                 &output_format, &use_ua_free_parsimony, &print_memory_usage,
+                 &logger_scorer](size_t iteration) {
     std::cout << "############ Logging for iteration " << iteration << " #######\n";
     merge.ComputeResultEdgeMutations();
+    logger_scorer.Update(merge.GetUpdatedNodes());
+    merge.ClearUpdatedNodes();
 
     const auto root_node = merge.GetResult().GetRoot();
+    auto [tree_counts, min_parsimony, max_parsimony, min_ua_free_parsimony] =
+        logger_scorer.ComputeWeightBelow(root_node, {});
     // Tree count
-    SubtreeWeight<TreeCount, MergeDAG> tree_counter{merge.GetResult()};
-    auto tree_count = tree_counter.ComputeWeightBelow(root_node, {});
+    auto tree_count = tree_counts.first;
     // Min Parsimony score
-    SubtreeWeight<BinaryParsimonyScore, MergeDAG> min_parsimony_scorer{
-        merge.GetResult()};
-    auto min_parsimony_score = min_parsimony_scorer.ComputeWeightBelow(root_node, {});
-    auto min_parsimony_count = min_parsimony_scorer.MinWeightCount(root_node, {});
+    auto min_parsimony_score = min_parsimony.first;
+    auto min_parsimony_count = min_parsimony.second;
     // Max Parsimony score
-    SubtreeWeight<MaxBinaryParsimonyScore, MergeDAG> max_parsimony_scorer{
-        merge.GetResult()};
-    auto max_parsimony_score = max_parsimony_scorer.ComputeWeightBelow(root_node, {});
+    auto max_parsimony_score = max_parsimony.first;
     // Min UA-FREE Parsimony score
-    SubtreeWeight<UAFreeParsimonyScore, MergeDAG> min_ua_free_parsimony_scorer{
-        merge.GetResult()};
-    auto min_ua_free_parsimony_score =
-        min_ua_free_parsimony_scorer.ComputeWeightBelow(root_node, {});
-    auto min_ua_free_parsimony_count =
-        min_ua_free_parsimony_scorer.MinWeightCount(root_node, {});
-    // Min Sum RF Distance
+    auto min_ua_free_parsimony_score = min_ua_free_parsimony.first;
+    auto min_ua_free_parsimony_count = min_ua_free_parsimony.second;
+    // Min and Max Sum RF Distance, in a single pass. The max ops share the
+    // reference DAG statistics computed for the min ops.
     SumRFDistance min_sum_rf_dist_weight_ops{merge, merge};
+    MaxSumRFDistance max_sum_rf_dist_weight_ops{min_sum_rf_dist_weight_ops};
     auto min_shift_sum = min_sum_rf_dist_weight_ops.GetOps().GetShiftSum();
-    SubtreeWeight<SumRFDistance, MergeDAG> min_sum_rf_dist_scorer{merge.GetResult()};
-    auto min_sum_rf_distance = min_sum_rf_dist_scorer.ComputeWeightBelow(
-        root_node, min_sum_rf_dist_weight_ops);
-    min_sum_rf_distance += min_shift_sum;
-    auto min_sum_rf_count =
-        min_sum_rf_dist_scorer.MinWeightCount(root_node, min_sum_rf_dist_weight_ops);
-    // Max Sum RF Distance
-    MaxSumRFDistance max_sum_rf_dist_weight_ops{merge, merge};
     auto max_shift_sum = max_sum_rf_dist_weight_ops.GetOps().GetShiftSum();
-    SubtreeWeight<MaxSumRFDistance, MergeDAG> max_sum_rf_dist_scorer{merge.GetResult()};
-    auto max_sum_rf_distance = max_sum_rf_dist_scorer.ComputeWeightBelow(
-        root_node, max_sum_rf_dist_weight_ops);
-    max_sum_rf_distance += max_shift_sum;
-    auto max_sum_rf_count =
-        max_sum_rf_dist_scorer.MinWeightCount(root_node, max_sum_rf_dist_weight_ops);
+    SubtreeWeight<FusedWeightOps<SumRFDistance, MaxSumRFDistance>, MergeDAG>
+        sum_rf_dist_scorer{merge.GetResult()};
+    auto [min_sum_rf, max_sum_rf] = sum_rf_dist_scorer.ComputeWeightBelow(
+        root_node, FusedWeightOps<SumRFDistance, MaxSumRFDistance>{
+                       std::move(min_sum_rf_dist_weight_ops),
+                       std::move(max_sum_rf_dist_weight_ops)});
+    ArbitraryInt min_sum_rf_distance = min_sum_rf.first + min_shift_sum;
+    auto min_sum_rf_count = min_sum_rf.second;
+    ArbitraryInt max_sum_rf_distance = max_sum_rf.first + max_shift_sum;
+    auto max_sum_rf_count = max_sum_rf.second;
 
     log_timer.stop();
 
@@ -807,6 +815,9 @@ int main(int argc, char** argv) {  // NOLINT(bugprone-exception-escape)
     std::cout << "Optimal trees in DAG: " << min_parsimony_count << "\n";
     std::cout << "Min summed RF distance over trees: " << min_sum_rf_distance << "\n";
     std::cout << "Max summed RF distance over trees: " << max_sum_rf_distance << "\n";
+    if (print_memory_usage) {
+      std::cout << "Memory usage in bytes:\n" << merge.MemoryUsage();
+    }
 
     logfile << '\n'
             << iteration << '\t' << tree_count << '\t'
@@ -929,7 +940,7 @@ int main(int argc, char** argv) {  // NOLINT(bugprone-exception-escape)
       if (sample_method == SampleMethod::Random) {
         return AddMATConversion(weight_bin.SampleTree({}, subtree_node));
       } else if (sample_method == SampleMethod::UniformRandom) {
-        SubtreeWeight<TreeCount, MergeDAG> uniform_sampling_weight{
+        SubtreeWeight<LogTreeCount, MergeDAG> uniform_sampling_weight{
             merge.GetResult(), main_rng.GenerateSeed()};
         return AddMATConversion(
             uniform_sampling_weight.UniformSampleTree({}, subtree_node));